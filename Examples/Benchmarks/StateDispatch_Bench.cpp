@@ -0,0 +1,43 @@
+/**
+ *  Times state dispatch in the code generated from StateDispatch500.tebnf.  Replaces the
+ *  generated Bench_Main.cpp: runs the Dispatch500 state table for a few seconds, stops it,
+ *  and prints the state transitions it made per second.
+ *
+ *  Usage: bench [seconds]
+ */
+
+//Generated includes:
+#include "Dispatch500.hpp"
+#include "bench.hpp"
+
+//System includes:
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+int main(int argc, const char* argv[])
+{
+  int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+  if(seconds <= 0)
+  {
+    std::cerr << "Usage: " << argv[0] << " [seconds]" << std::endl;
+    return EXIT_FAILURE;
+  }
+#if defined(STATE_TABLE_COMPUTED_GOTO) && defined(__GNUC__)
+  std::cout << "Dispatch: computed goto" << std::endl;
+#else
+  std::cout << "Dispatch: switch" << std::endl;
+#endif
+  auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<Dispatch500> pStateTable(new Dispatch500());
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  pStateTable->stop();
+  pStateTable.reset(); //Joins the worker thread, so the count below is final
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  double transitions = static_cast<double>(bench::get()->s_n);
+  std::cout << "Transitions: " << bench::get()->s_n << " in " << elapsed.count() << " s\n"
+            << "Per second:  " << transitions / elapsed.count() << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -4,6 +4,7 @@
 //Local includes:
 #include "Nodes/Element.hpp"
 #include "Nodes/Elements.hpp"
+#include "Nodes/GrammarElement.hpp"
 
 //System includes:
 #include <iomanip>
@@ -11,6 +12,10 @@
 #include <sstream>
 
 std::map<std::string, std::vector<std::string> > Generator::m_elementFilesPerElementMap;
+size_t Generator::m_shardCount = 1;
+bool Generator::m_isSessionScheduled = false;
+bool Generator::m_isInlineActions = false;
+std::map<std::string, std::string> Generator::m_runtimeOptions;
 
 void Generator::generate(const std::string& dirPath, const std::string& appName)
 {
@@ -22,12 +27,41 @@ void Generator::generate(const std::string& dirPath, const std::string& appName)
   pMainInfo->typeNameStr = appName;
   pMainInfo->isCppMain = true;
   pMainInfo->cppIncludes.push_back("#include <iostream>\n");
+  pMainInfo->cppIncludes.push_back("#include \"RuntimeConfig.hpp\"\n");
+  if(isSharded() && !isSessionScheduled())
+  {
+    pMainInfo->cppIncludes.push_back("#include <memory>\n");
+    pMainInfo->cppIncludes.push_back("#include <vector>\n");
+  }
   pMainInfo->cppStatements.push_back("\nint main(int argc, const char* argv[])\n");
   pMainInfo->cppStatements.push_back("{\n");
   pMainInfo->cppStatements.push_back(spc + "try\n");
   pMainInfo->cppStatements.push_back(spc + "{\n");
+  pMainInfo->cppStatements.push_back(spc + spc + "//Settings in the file override the ones the application was generated with\n");
+  pMainInfo->cppStatements.push_back(spc + spc + "RuntimeConfig::get().load(argc > 1 ? argv[1] : \"" + appName + ".conf\");\n");
+  pMainInfo->cppStatements.push_back(spc + spc + "RuntimeConfig::get().lockMemory();\n");
+  if(isSharded())
+  {
+    pMainInfo->cppIncludes.push_back("#if defined(__linux__)\n#include <pthread.h>\n#include <signal.h>\n#endif\n");
+    pMainInfo->cppStatements.push_back(
+      "#if defined(__linux__)\n"
+      + spc + spc + "//Threads inherit the mask, so SIGINT and SIGTERM only reach the wait for them below\n"
+      + spc + spc + "sigset_t stopSignals;\n"
+      + spc + spc + "sigemptyset(&stopSignals);\n"
+      + spc + spc + "sigaddset(&stopSignals, SIGINT);\n"
+      + spc + spc + "sigaddset(&stopSignals, SIGTERM);\n"
+      + spc + spc + "pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);\n"
+      "#endif\n");
+  }
+  if(isSessionScheduled())
+  {
+    pMainInfo->cppIncludes.push_back("#include \"SessionScheduler.hpp\"\n");
+    pMainInfo->cppStatements.push_back(spc + spc + "SessionScheduler scheduler(RuntimeConfig::get().getWorkerCount());\n");
+  }
 
   size_t instanceCount = 1;
+  std::vector<std::string> stateTableNames;
+  std::string mergeReports;
   //Generate code for each element.
   for(std::shared_ptr<Element> pElement : Elements::elements())
   {
@@ -35,17 +69,78 @@ void Generator::generate(const std::string& dirPath, const std::string& appName)
     {
       pElement->generateCode();
       pElement->getCppTypeInfo()->writeCodeToDisk(dirPath);
+      if(isSharded() && pElement->getToken()->isElementGrammar())
+      {
+        auto pGrammar = std::dynamic_pointer_cast<GrammarElement>(pElement);
+        std::string mergeReport(pGrammar ? pGrammar->getMergeShardsReport(spc + spc) : std::string());
+        if(!mergeReport.empty())
+        {
+          pMainInfo->cppIncludes.push_back("#include \"" + pElement->getCppTypeInfo()->getTypeNameStr(false) + ".hpp\"\n");
+          mergeReports.append(mergeReport);
+        }
+      }
       if(pElement->getToken()->isElementStateTable())
       {
         std::string elemTypeName(pElement->getCppTypeInfo()->getTypeNameStr(false));
         pMainInfo->cppIncludes.push_back("#include \"" + elemTypeName + ".hpp\"\n");
         std::ostringstream line;
-        line << spc << spc << elemTypeName << " stateTable_" << instanceCount++ << ";\n";
+        if(isSessionScheduled())
+        {
+          //Session n of every state table runs on the same scheduler thread, as they share element instances.
+          line << spc << spc << "for(size_t shard = 0; shard < " << m_shardCount << "; shard++)\n"
+               << spc << spc << spc << "scheduler.add(new " << elemTypeName << "(shard), shard);\n";
+        }
+        else if(isSharded())
+        {
+          //Shard n of every state table shares the element instances of shard n.
+          std::ostringstream stateTableName;
+          stateTableName << "stateTable_" << instanceCount;
+          stateTableNames.push_back(stateTableName.str());
+          line << spc << spc << "std::vector<std::unique_ptr<" << elemTypeName << "> > " << stateTableName.str() << ";\n"
+               << spc << spc << "for(size_t shard = 0; shard < " << m_shardCount << "; shard++)\n"
+               << spc << spc << spc << stateTableName.str() << ".emplace_back(new " << elemTypeName << "(shard));\n";
+        }
+        else
+          line << spc << spc << elemTypeName << " stateTable_" << instanceCount << ";\n";
+        instanceCount++;
         pMainInfo->cppStatements.push_back(line.str());
       }        
     }
   }
 
+  if(isSharded())
+  {
+    std::string stopStatements("#if defined(__linux__)\n");
+    if(isSessionScheduled())
+    {
+      //The scheduler stops itself when a worker thread fails, and wait() then reports why.
+      stopStatements.append(
+        spc + spc + "timespec pollInterval = { 0, 100000000 }; //100 ms\n"
+        + spc + spc + "while(sigtimedwait(&stopSignals, nullptr, &pollInterval) < 0 && !scheduler.isStopped())\n"
+        + spc + spc + spc + "continue;\n"
+        + spc + spc + "scheduler.stop();\n");
+    }
+    else
+    {
+      stopStatements.append(
+        spc + spc + "int stopSignal = 0;\n"
+        + spc + spc + "sigwait(&stopSignals, &stopSignal);\n");
+    }
+    for(const std::string& stateTableName : stateTableNames)
+    {
+      stopStatements.append(spc + spc + "for(auto& rpStateTable : " + stateTableName + ")\n");
+      stopStatements.append(spc + spc + spc + "rpStateTable->stop();\n");
+    }
+    stopStatements.append("#endif\n");
+    pMainInfo->cppStatements.push_back(stopStatements);
+  }
+  if(isSessionScheduled())
+    pMainInfo->cppStatements.push_back(spc + spc + "scheduler.wait();\n");
+  for(const std::string& stateTableName : stateTableNames)
+    pMainInfo->cppStatements.push_back(spc + spc + stateTableName + ".clear(); //Joins the worker threads\n");
+  //Once stopped, the state tables no longer touch their shard's instances, so the $ counters can be merged.
+  if(!mergeReports.empty())
+    pMainInfo->cppStatements.push_back(spc + spc + "//Every shard's $ counters are added into the first shard's\n" + mergeReports);
   pMainInfo->cppStatements.push_back(spc + "}\n");
   pMainInfo->cppStatements.push_back(spc + "catch(const std::exception& ex)\n");
   pMainInfo->cppStatements.push_back(spc + "{\n");
@@ -61,6 +156,9 @@ void Generator::generate(const std::string& dirPath, const std::string& appName)
 
   generateConversionClass(dirPath);
   generateStaticVariableClass(dirPath);
+  generateRuntimeConfigClass(dirPath, appName);
+  if(isSessionScheduled())
+    generateSessionSchedulerClass(dirPath);
   generateClangFormatFile(dirPath);
   generateCMakelists(dirPath, appName);  
 
@@ -79,9 +177,15 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "#ifndef CONVERSION_HPP\n"
                    << "#define CONVERSION_HPP\n\n"
 
+                   << "#include <array>\n"
+                   << "#include <cstring>\n"
                    << "#include <errno.h>\n"
                    << "#include <iostream>\n"
-                   << "#include <stdint.h>\n"
+                   << "#include <memory>\n";
+    if(isSharded())
+      conversionFile << "#include <mutex>\n";
+    conversionFile << "#include <stdint.h>\n"
+                   << "#include <stdexcept>\n"
                    << "#include <string>\n"
                    << "#include <type_traits>\n"
                    << "#include <vector>\n"
@@ -93,10 +197,352 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "#include <netinet/in.h> //hton, ntoh\n"
                    << "#include <sys/socket.h> //sockets\n\n"
 #endif
-                   << "class Conversion\n"
+                   << "//VS2013 predates noexcept and thread_local. __declspec(thread) suits the\n"
+                   << "//constant initialized pointers that TEBNF_THREAD_LOCAL marks.\n"
+                   << "#if defined(_MSC_VER) && _MSC_VER < 1900\n"
+                   << "#define TEBNF_NOEXCEPT throw()\n"
+                   << "#define TEBNF_THREAD_LOCAL __declspec(thread)\n"
+                   << "#else\n"
+                   << "#define TEBNF_NOEXCEPT noexcept\n"
+                   << "#define TEBNF_THREAD_LOCAL thread_local\n"
+                   << "#endif\n\n"
+                   << "/*\n"
+                   << " * Growable byte storage for socket reads.  Unlike std::vector, growing it\n"
+                   << " * leaves the new bytes uninitialized, so a datagram is received straight into\n"
+                   << " * spare capacity, and the bytes already held keep their address until the\n"
+                   << " * capacity has to grow.\n"
+                   << " */\n"
+                   << "class ByteBuffer\n"
+                   << "{\n"
+                   << "public:\n"
+                   << "  ByteBuffer() : m_pBytes(), m_size(0), m_capacity(0) {}\n"
+                   << "  size_t size() const { return m_size; }\n"
+                   << "  size_t capacity() const { return m_capacity; }\n"
+                   << "  bool empty() const { return 0 == m_size; }\n"
+                   << "  void clear() { m_size = 0; }\n"
+                   << "  void reserve(size_t capacity)\n"
+                   << "  {\n"
+                   << "    if(capacity <= m_capacity) return;\n"
+                   << "    std::unique_ptr<uint8_t[]> pBytes(new uint8_t[capacity]);\n"
+                   << "    if(m_size > 0) memcpy(pBytes.get(), m_pBytes.get(), m_size);\n"
+                   << "    m_pBytes.swap(pBytes);\n"
+                   << "    m_capacity = capacity;\n"
+                   << "  }\n"
+                   << "  /* Growing leaves the new bytes for the caller to write. */\n"
+                   << "  void resize(size_t size)\n"
+                   << "  {\n"
+                   << "    if(size > m_capacity) reserve(size > 2 * m_capacity ? size : 2 * m_capacity);\n"
+                   << "    m_size = size;\n"
+                   << "  }\n"
+                   << "  /* Writes to the spare capacity so its pages are mapped before the first read. */\n"
+                   << "  void prefault(size_t capacity)\n"
+                   << "  {\n"
+                   << "    reserve(capacity);\n"
+                   << "    memset(m_pBytes.get() + m_size, 0, m_capacity - m_size);\n"
+                   << "  }\n"
+                   << "  uint8_t* data() { return m_pBytes.get(); }\n"
+                   << "  const uint8_t* data() const { return m_pBytes.get(); }\n"
+                   << "  uint8_t* begin() { return data(); }\n"
+                   << "  uint8_t* end() { return data() + m_size; }\n"
+                   << "  const uint8_t* begin() const { return data(); }\n"
+                   << "  const uint8_t* end() const { return data() + m_size; }\n"
+                   << "  uint8_t& operator[](size_t idx) { return m_pBytes[idx]; }\n"
+                   << "  const uint8_t& operator[](size_t idx) const { return m_pBytes[idx]; }\n"
+                   << "private:\n"
+                   << "  ByteBuffer(const ByteBuffer&);\n"
+                   << "  ByteBuffer& operator=(const ByteBuffer&);\n"
+                   << "  std::unique_ptr<uint8_t[]> m_pBytes;\n"
+                   << "  size_t m_size;\n"
+                   << "  size_t m_capacity;\n"
+                   << "};\n\n"
+
+                   << "/* Read-only window onto bytes owned elsewhere, such as an IO element's m_data. */\n"
+                   << "struct DataView\n"
+                   << "{\n"
+                   << "  DataView() : pData(nullptr), length(0) {}\n"
+                   << "  DataView(const uint8_t* pBegin, size_t len) : pData(pBegin), length(len) {}\n"
+                   << "  DataView(const std::vector<uint8_t>& data) : pData(data.empty() ? nullptr : &data[0]), length(data.size()) {}\n"
+                   << "  DataView(const ByteBuffer& data) : pData(data.empty() ? nullptr : data.data()), length(data.size()) {}\n"
+                   << "  size_t size() const { return length; }\n"
+                   << "  bool empty() const { return 0 == length; }\n"
+                   << "  const uint8_t* begin() const { return pData; }\n"
+                   << "  const uint8_t* end() const { return pData + length; }\n"
+                   << "  const uint8_t& operator[](size_t idx) const { return pData[idx]; }\n"
+                   << "  const uint8_t* pData;\n"
+                   << "  size_t length;\n"
+                   << "};\n\n"
+
+                   << "/*\n"
+                   << " * Variable-length grammar field.  Unmarshaling borrows the bytes from the\n"
+                   << " * input buffer instead of copying them.  materialize(), or any write through\n"
+                   << " * a non-const accessor, copies them into storage owned by the field so the\n"
+                   << " * value can outlive the buffer.\n"
+                   << " */\n"
+                   << "template<typename T>\n"
+                   << "class ByteField\n"
+                   << "{\n"
+                   << "public:\n"
+                   << "  ByteField() : m_pView(nullptr), m_count(0), m_owned() {}\n"
+                   << "  explicit ByteField(size_t count) : m_pView(nullptr), m_count(count), m_owned(count) {}\n"
+                   << "  /* Sets the element count the next unmarshal borrows, dropping any borrowed bytes. */\n"
+                   << "  void expect(size_t count) { m_pView = nullptr; m_count = count; }\n"
+                   << "  size_t expected() const { return m_count; }\n"
+                   << "  void borrow(const uint8_t* pData, size_t count) { m_pView = reinterpret_cast<const T*>(pData); m_count = count; }\n"
+                   << "  bool isBorrowed() const { return nullptr != m_pView; }\n"
+                   << "  void materialize()\n"
+                   << "  {\n"
+                   << "    if(!m_pView) return;\n"
+                   << "    m_owned.assign(m_pView, m_pView + m_count);\n"
+                   << "    m_pView = nullptr;\n"
+                   << "  }\n"
+                   << "  size_t size() const { return m_pView ? m_count : m_owned.size(); }\n"
+                   << "  bool empty() const { return 0 == size(); }\n"
+                   << "  void resize(size_t count) { materialize(); m_owned.resize(count); m_count = count; }\n"
+                   << "  const T* data() const { return m_pView ? m_pView : m_owned.data(); }\n"
+                   << "  T* data() { materialize(); return m_owned.data(); }\n"
+                   << "  const T* begin() const { return data(); }\n"
+                   << "  const T* end() const { return data() + size(); }\n"
+                   << "  const T& operator[](size_t idx) const { return data()[idx]; }\n"
+                   << "  T& operator[](size_t idx) { materialize(); return m_owned[idx]; }\n"
+                   << "private:\n"
+                   << "  const T* m_pView;\n"
+                   << "  size_t m_count;\n"
+                   << "  std::vector<T> m_owned;\n"
+                   << "};\n\n"
+
+                   << "/* Vector stored inline for ranges whose maximum is known, e.g. INT_16{2,5}. */\n"
+                   << "template<typename T, size_t N>\n"
+                   << "class BoundedVector\n"
+                   << "{\n"
+                   << "public:\n"
+                   << "  BoundedVector() : m_items(), m_count(0) {}\n"
+                   << "  explicit BoundedVector(size_t count) : m_items(), m_count(0) { resize(count); }\n"
+                   << "  static size_t capacity() { return N; }\n"
+                   << "  size_t size() const { return m_count; }\n"
+                   << "  bool empty() const { return 0 == m_count; }\n"
+                   << "  void clear() { m_count = 0; }\n"
+                   << "  void resize(size_t count)\n"
+                   << "  {\n"
+                   << "    if(count > N) throw std::length_error(\"Range maximum exceeded\");\n"
+                   << "    m_count = count;\n"
+                   << "  }\n"
+                   << "  void push_back(const T& item) { resize(m_count + 1); m_items[m_count - 1] = item; }\n"
+                   << "  T* data() { return m_items.data(); }\n"
+                   << "  const T* data() const { return m_items.data(); }\n"
+                   << "  T* begin() { return data(); }\n"
+                   << "  T* end() { return data() + m_count; }\n"
+                   << "  const T* begin() const { return data(); }\n"
+                   << "  const T* end() const { return data() + m_count; }\n"
+                   << "  T& operator[](size_t idx) { return m_items[idx]; }\n"
+                   << "  const T& operator[](size_t idx) const { return m_items[idx]; }\n"
+                   << "private:\n"
+                   << "  std::array<T, N> m_items;\n"
+                   << "  size_t m_count;\n"
+                   << "};\n\n"
+
+                   << "/* Bytes an output sends without copying them first, like a POSIX iovec or a WSABUF. */\n"
+                   << "struct IoSlice\n"
+                   << "{\n"
+                   << "  const uint8_t* pData;\n"
+                   << "  size_t len;\n"
+                   << "};\n\n"
+
+                   << "/* One fixed-width column of a columnar output; type is 'u', 'i', 'f' or 'b' for raw bytes. */\n"
+                   << "struct ColumnSchema\n"
+                   << "{\n"
+                   << "  const char* name;\n"
+                   << "  uint32_t width;\n"
+                   << "  char type;\n"
+                   << "};\n\n"
+
+                   << "#if defined(__SSE4_2__) || (defined(_MSC_VER) && defined(__AVX__))\n"
+                   << "#define CHECKSUM_CRC32C_INSTRUCTION\n"
+                   << "#include <nmmintrin.h> //_mm_crc32_u8, _mm_crc32_u64\n"
+                   << "#endif\n"
+                   << "#if (defined(__PCLMUL__) && defined(__SSE4_1__)) || (defined(_MSC_VER) && defined(__AVX__))\n"
+                   << "#define CHECKSUM_CRC32_CLMUL\n"
+                   << "#include <smmintrin.h> //_mm_extract_epi32\n"
+                   << "#include <wmmintrin.h> //_mm_clmulepi64_si128\n"
+                   << "#endif\n\n"
+
+                   << "/*\n"
+                   << " * Checksum field types, e.g. crc = CRC_32C{first, last}, computed over the wire\n"
+                   << " * bytes of the fields they cover.  CRC-32C uses the SSE4.2 crc32 instruction and\n"
+                   << " * CRC-32 uses PCLMULQDQ folding when the compiler targets them, else a table.\n"
+                   << " */\n"
+                   << "struct Checksum\n"
+                   << "{\n"
+                   << "  static uint32_t crc32c(const uint8_t* pData, size_t len)\n"
+                   << "  {\n"
+                   << "    uint32_t crc = 0xFFFFFFFFu;\n"
+                   << "#if defined(CHECKSUM_CRC32C_INSTRUCTION)\n"
+                   << "#if defined(__x86_64__) || defined(_M_X64)\n"
+                   << "    for(; len >= sizeof(uint64_t); pData += sizeof(uint64_t), len -= sizeof(uint64_t))\n"
+                   << "    {\n"
+                   << "      uint64_t word;\n"
+                   << "      memcpy(&word, pData, sizeof(word));\n"
+                   << "      crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));\n"
+                   << "    }\n"
+                   << "#endif\n"
+                   << "    for(; len > 0; ++pData, --len)\n"
+                   << "      crc = _mm_crc32_u8(crc, *pData);\n"
+                   << "#else\n"
+                   << "    crc = crcTableUpdate(table<0x82F63B78u>(), crc, pData, len);\n"
+                   << "#endif\n"
+                   << "    return ~crc;\n"
+                   << "  }\n\n"
+
+                   << "  static uint32_t crc32(const uint8_t* pData, size_t len)\n"
+                   << "  {\n"
+                   << "    uint32_t crc = 0xFFFFFFFFu;\n"
+                   << "#if defined(CHECKSUM_CRC32_CLMUL)\n"
+                   << "    if(len >= 64)\n"
+                   << "    {\n"
+                   << "      size_t foldLen = len & ~static_cast<size_t>(15);\n"
+                   << "      crc = crc32Fold(pData, foldLen, crc);\n"
+                   << "      pData += foldLen;\n"
+                   << "      len -= foldLen;\n"
+                   << "    }\n"
+                   << "#endif\n"
+                   << "    return ~crcTableUpdate(table<0xEDB88320u>(), crc, pData, len);\n"
+                   << "  }\n\n"
+
+                   << "  static uint32_t adler32(const uint8_t* pData, size_t len)\n"
+                   << "  {\n"
+                   << "    //5552 bytes is the most that can be summed before the 32 bit sums overflow.\n"
+                   << "    uint32_t a = 1, b = 0;\n"
+                   << "    while(len > 0)\n"
+                   << "    {\n"
+                   << "      size_t blockLen = len < 5552 ? len : 5552;\n"
+                   << "      len -= blockLen;\n"
+                   << "      for(; blockLen > 0; --blockLen)\n"
+                   << "      {\n"
+                   << "        a += *pData++;\n"
+                   << "        b += a;\n"
+                   << "      }\n"
+                   << "      a %= 65521;\n"
+                   << "      b %= 65521;\n"
+                   << "    }\n"
+                   << "    return (b << 16) | a;\n"
+                   << "  }\n\n"
+
+                   << "  static uint16_t fletcher16(const uint8_t* pData, size_t len)\n"
+                   << "  {\n"
+                   << "    uint32_t a = 0, b = 0;\n"
+                   << "    while(len > 0)\n"
+                   << "    {\n"
+                   << "      size_t blockLen = len < 5802 ? len : 5802;\n"
+                   << "      len -= blockLen;\n"
+                   << "      for(; blockLen > 0; --blockLen)\n"
+                   << "      {\n"
+                   << "        a += *pData++;\n"
+                   << "        b += a;\n"
+                   << "      }\n"
+                   << "      a %= 255;\n"
+                   << "      b %= 255;\n"
+                   << "    }\n"
+                   << "    return static_cast<uint16_t>((b << 8) | a);\n"
+                   << "  }\n\n"
+
+                   << "private:\n"
+                   << "  /* Reflected CRC lookup table for POLY, built on first use. */\n"
+                   << "  template<uint32_t POLY>\n"
+                   << "  static const std::array<uint32_t, 256>& table()\n"
+                   << "  {\n"
+                   << "    static const std::array<uint32_t, 256> s_table = []()\n"
+                   << "    {\n"
+                   << "      std::array<uint32_t, 256> entries;\n"
+                   << "      for(uint32_t i = 0; i < 256; ++i)\n"
+                   << "      {\n"
+                   << "        uint32_t crc = i;\n"
+                   << "        for(int bit = 0; bit < 8; ++bit)\n"
+                   << "          crc = (crc >> 1) ^ ((crc & 1) ? POLY : 0);\n"
+                   << "        entries[i] = crc;\n"
+                   << "      }\n"
+                   << "      return entries;\n"
+                   << "    }();\n"
+                   << "    return s_table;\n"
+                   << "  }\n\n"
+
+                   << "  static uint32_t crcTableUpdate(const std::array<uint32_t, 256>& entries, uint32_t crc, const uint8_t* pData, size_t len)\n"
+                   << "  {\n"
+                   << "    for(; len > 0; ++pData, --len)\n"
+                   << "      crc = entries[(crc ^ *pData) & 0xFF] ^ (crc >> 8);\n"
+                   << "    return crc;\n"
+                   << "  }\n\n"
+
+                   << "#if defined(CHECKSUM_CRC32_CLMUL)\n"
+                   << "  /* Folds len bytes, at least 64 and a multiple of 16, four lanes at a time, then reduces to 32 bits. */\n"
+                   << "  static uint32_t crc32Fold(const uint8_t* pData, size_t len, uint32_t crc)\n"
+                   << "  {\n"
+                   << "    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);\n"
+                   << "    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);\n"
+                   << "    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);\n"
+                   << "    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);\n"
+                   << "    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);\n"
+                   << "    auto load = [](const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };\n"
+                   << "    auto fold = [](__m128i x, __m128i k, __m128i next)\n"
+                   << "    {\n"
+                   << "      return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), next);\n"
+                   << "    };\n"
+                   << "    __m128i x1 = _mm_xor_si128(load(pData), _mm_cvtsi32_si128(static_cast<int>(crc)));\n"
+                   << "    __m128i x2 = load(pData + 16);\n"
+                   << "    __m128i x3 = load(pData + 32);\n"
+                   << "    __m128i x4 = load(pData + 48);\n"
+                   << "    for(pData += 64, len -= 64; len >= 64; pData += 64, len -= 64)\n"
+                   << "    {\n"
+                   << "      x1 = fold(x1, k1k2, load(pData));\n"
+                   << "      x2 = fold(x2, k1k2, load(pData + 16));\n"
+                   << "      x3 = fold(x3, k1k2, load(pData + 32));\n"
+                   << "      x4 = fold(x4, k1k2, load(pData + 48));\n"
+                   << "    }\n"
+                   << "    x1 = fold(fold(fold(x1, k3k4, x2), k3k4, x3), k3k4, x4);\n"
+                   << "    for(; len >= 16; pData += 16, len -= 16)\n"
+                   << "      x1 = fold(x1, k3k4, load(pData));\n"
+                   << "    //128 bits to 64, then Barrett reduction to 32.\n"
+                   << "    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));\n"
+                   << "    x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00));\n"
+                   << "    __m128i reduced = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);\n"
+                   << "    reduced = _mm_clmulepi64_si128(_mm_and_si128(reduced, mask32), poly, 0x00);\n"
+                   << "    return static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x1, reduced), 1));\n"
+                   << "  }\n"
+                   << "#endif\n"
+                   << "};\n\n";
+
+    if(isSharded())
+      conversionFile << "/* Instances of one element, one per state table shard, kept until the program ends. */\n"
+                     << "template<typename T>\n"
+                     << "class ShardInstances\n"
+                     << "{\n"
+                     << "public:\n"
+                     << "  /* @return the instance of a shard, made by makeInstance the first time the shard asks. */\n"
+                     << "  template<typename MAKE_T>\n"
+                     << "  T* get(size_t shard, MAKE_T makeInstance)\n"
+                     << "  {\n"
+                     << "    std::lock_guard<std::mutex> lock(m_mutex);\n"
+                     << "    if(m_instances.size() <= shard)\n"
+                     << "      m_instances.resize(shard + 1);\n"
+                     << "    if(!m_instances[shard])\n"
+                     << "      m_instances[shard].reset(makeInstance());\n"
+                     << "    return m_instances[shard].get();\n"
+                     << "  }\n"
+                     << "  /* Calls func with each shard's instance, e.g. to merge $ counters once the shards stop. */\n"
+                     << "  template<typename FUNC_T>\n"
+                     << "  void forEach(FUNC_T func)\n"
+                     << "  {\n"
+                     << "    std::lock_guard<std::mutex> lock(m_mutex);\n"
+                     << "    for(auto& rpInstance : m_instances)\n"
+                     << "      if(rpInstance) func(*rpInstance);\n"
+                     << "  }\n"
+                     << "private:\n"
+                     << "  std::mutex m_mutex;\n"
+                     << "  std::vector<std::unique_ptr<T> > m_instances;\n"
+                     << "};\n\n";
+
+    conversionFile << "class Conversion\n"
                    << "{\n"
                    << "public:\n"
-                   << "  static bool unmarshal(std::vector<uint8_t> data, uint8_t& rValue, size_t& rOffset)\n"
+                   << "  static bool unmarshal(const DataView& data, uint8_t& rValue, size_t& rOffset)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
                    << "    rValue = data[rOffset];\n"
@@ -114,7 +560,7 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "   }\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, int8_t& rValue, size_t& rOffset)\n"
+                   << "  static bool unmarshal(const DataView& data, int8_t& rValue, size_t& rOffset)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
                    << "    rValue = data[rOffset];\n"
@@ -132,10 +578,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    }\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, uint16_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, uint16_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = ntohs(unmarshal<uint8_t, uint16_t>(data, rOffset, diffBytes));\n"
+                   << "    rValue = ntohs(unmarshal<uint16_t>(data, rOffset, diffBytes));\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, uint16_t value, bool append)\n"
@@ -143,10 +589,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshal(rData, sizeof(uint16_t), htons(value), append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, int16_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, int16_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = ntohs(unmarshal<uint8_t, int16_t>(data, rOffset, diffBytes));\n"
+                   << "    rValue = ntohs(unmarshal<int16_t>(data, rOffset, diffBytes));\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, int16_t value, bool append)\n"
@@ -154,10 +600,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshal(rData, sizeof(int16_t), htons(value), append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, uint32_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, uint32_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = ntohl(unmarshal<uint8_t, uint32_t>(data, rOffset, diffBytes));\n"
+                   << "    rValue = ntohl(unmarshal<uint32_t>(data, rOffset, diffBytes));\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, uint32_t value, bool append)\n"
@@ -165,10 +611,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshal(rData, sizeof(uint32_t), htonl(value), append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, int32_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, int32_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = ntohl(unmarshal<uint8_t, int32_t>(data, rOffset, diffBytes));\n"
+                   << "    rValue = ntohl(unmarshal<int32_t>(data, rOffset, diffBytes));\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, int32_t value, bool append)\n"
@@ -176,10 +622,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshal(rData, sizeof(int32_t), htonl(value), append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, uint64_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, uint64_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = ntohll(unmarshal<uint8_t, uint64_t>(data, rOffset, diffBytes));\n"
+                   << "    rValue = ntohll(unmarshal<uint64_t>(data, rOffset, diffBytes));\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, uint64_t value, bool append)\n"
@@ -187,10 +633,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshal(rData, sizeof(uint64_t), htonll(value), append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, int64_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, int64_t& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = ntohll(unmarshal<uint8_t, int64_t>(data, rOffset, diffBytes));\n"
+                   << "    rValue = ntohll(unmarshal<int64_t>(data, rOffset, diffBytes));\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, int64_t value, bool append)\n"
@@ -198,10 +644,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshal(rData, sizeof(int64_t), htonll(value), append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, float& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, float& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = unmarshalFloat<uint8_t, float, FloatConvert>(data, rOffset, diffBytes);\n"
+                   << "    rValue = unmarshalFloat<float, FloatConvert>(data, rOffset, diffBytes);\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, float value, bool append)\n"
@@ -209,10 +655,10 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshalFloat<uint8_t, float, FloatConvert>(rData, sizeof(float), value, append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, double& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, double& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
-                   << "    rValue = unmarshalFloat<uint8_t, double, DoubleConvert>(data, rOffset, diffBytes);\n"
+                   << "    rValue = unmarshalFloat<double, DoubleConvert>(data, rOffset, diffBytes);\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, double value, bool append)\n"
@@ -220,19 +666,19 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    marshalFloat<uint8_t, double, DoubleConvert>(rData, sizeof(double), value, append);\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, std::string& rValue, size_t& rOffset, const std::string& expected = std::string(), size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, std::string& rValue, size_t& rOffset, const std::string& expected = std::string(), size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + rValue.size()) && expected.empty()) return false;\n"
                    << "    if(!expected.empty() && data.size() >= expected.size())\n"
                    << "    {\n"
-                   << "      std::string temp(reinterpret_cast<char*>(&data[rOffset]), expected.size());\n"
+                   << "      std::string temp(reinterpret_cast<const char*>(&data[rOffset]), expected.size());\n"
                    << "      if(temp == expected)\n"
                    << "      {\n"
                    << "        rValue = temp;\n"
                    << "        return true;\n"
                    << "      }\n"
                    << "    }\n"
-                   << "    rValue.assign(reinterpret_cast<char*>(&data[rOffset]), data.size());\n"
+                   << "    rValue.assign(reinterpret_cast<const char*>(&data[rOffset]), data.size());\n"
                    << "    return true;\n"
                    << "  }\n"
                    << "  static void marshal(std::vector<uint8_t>& rData, const std::string& value, bool append)\n"
@@ -241,7 +687,7 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    else rData.assign(value.begin(), value.end());\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, std::vector<int8_t>& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, std::vector<int8_t>& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + rValue.size())) return false;\n"
                    << "    size_t len = rValue.size();\n"
@@ -256,7 +702,7 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    else rData.assign(value.begin(), value.end());\n"
                    << "  }\n\n"
 
-                   << "  static bool unmarshal(std::vector<uint8_t> data, std::vector<uint8_t>& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  static bool unmarshal(const DataView& data, std::vector<uint8_t>& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
                    << "  {\n"
                    << "    if(data.size() < (rOffset + rValue.size())) return false;\n"
                    << "    size_t len = rValue.size();\n"
@@ -272,26 +718,64 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "  }\n\n"
 
                    << "  template<typename T>\n"
-                   << "  static bool unmarshalNumString(const std::vector<uint8_t>& data, T& rValue, size_t sizeOfNumStr, size_t& rOffset)\n"
+                   << "  static bool unmarshal(const DataView& data, ByteField<T>& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  {\n"
+                   << "    size_t len = rValue.expected();\n"
+                   << "    if(data.size() < (rOffset + len)) return false;\n"
+                   << "    rValue.borrow(data.begin() + rOffset, len);\n"
+                   << "    rOffset += len;\n"
+                   << "    return true;\n"
+                   << "  }\n"
+                   << "  template<typename T>\n"
+                   << "  static void marshal(std::vector<uint8_t>& rData, const ByteField<T>& value, bool append)\n"
+                   << "  {\n"
+                   << "    if(!append) rData.clear();\n"
+                   << "    auto pBytes = reinterpret_cast<const uint8_t*>(value.begin());\n"
+                   << "    rData.insert(rData.end(), pBytes, pBytes + value.size());\n"
+                   << "  }\n\n"
+
+                   << "  template<typename T, size_t N>\n"
+                   << "  static bool unmarshal(const DataView& data, BoundedVector<T, N>& rValue, size_t& rOffset, size_t diffBytes = 0)\n"
+                   << "  {\n"
+                   << "    if(data.size() < (rOffset + rValue.size() * sizeof(T))) return false;\n"
+                   << "    load(data.begin() + rOffset, rValue);\n"
+                   << "    rOffset += rValue.size() * sizeof(T);\n"
+                   << "    return true;\n"
+                   << "  }\n"
+                   << "  template<typename T, size_t N>\n"
+                   << "  static void marshal(std::vector<uint8_t>& rData, const BoundedVector<T, N>& value, bool append)\n"
+                   << "  {\n"
+                   << "    if(!append) rData.clear();\n"
+                   << "    for(const T& item : value) marshal(rData, item, true);\n"
+                   << "  }\n\n"
+
+                   << "  template<typename T>\n"
+                   << "  static bool unmarshalNumString(const DataView& data, T& rValue, size_t sizeOfNumStr, size_t& rOffset)\n"
                    << "  {\n"
-                   << "    errno = 0; //To distinguish success or failure after strto_ call\n"
                    << "    if(data.size() < (rOffset + sizeof(rValue))) return false;\n"
+                   << "    bool success = loadNumString(&data[rOffset], rValue, sizeOfNumStr);\n"
+                   << "    rOffset += sizeOfNumStr;\n"
+                   << "    return success;\n"
+                   << "  }\n"
+                   << "  template<typename T>\n"
+                   << "  static bool loadNumString(const uint8_t* pData, T& rValue, size_t sizeOfNumStr)\n"
+                   << "  {\n"
+                   << "    errno = 0; //To distinguish success or failure after strto_ call\n"
                    << "    char* pEnd = nullptr;\n"
-                   << "    std::vector<char> num(sizeOfNumStr);\n"
-                   << "    memcpy(&num[0], reinterpret_cast<const char*>(&data[rOffset]), sizeOfNumStr);\n"
+                   << "    std::vector<char> num(sizeOfNumStr + 1, 0);\n"
+                   << "    memcpy(&num[0], reinterpret_cast<const char*>(pData), sizeOfNumStr);\n"
                    << "    if(std::is_floating_point<T>::value)\n"
                    << "    {\n"
-                   << "      if(sizeOfNumStr == 1) rValue = static_cast<T>(data[rOffset]);\n"
+                   << "      if(sizeOfNumStr == 1) rValue = static_cast<T>(pData[0]);\n"
                    << "      else if(sizeOfNumStr <= 4) rValue = static_cast<T>(strtof(&num[0], &pEnd));\n"
                    << "      else rValue = static_cast<T>(strtold(&num[0], &pEnd));\n"
                    << "    }\n"
                    << "    else\n"
                    << "    {\n"
-                   << "      if(sizeOfNumStr == 1) rValue = static_cast<T>(data[rOffset]);\n"
+                   << "      if(sizeOfNumStr == 1) rValue = static_cast<T>(pData[0]);\n"
                    << "      else if(sizeOfNumStr <= 4) rValue = static_cast<T>(strtol(&num[0], &pEnd, 10));\n"
                    << "      else rValue = static_cast<T>(strtoll(&num[0], &pEnd, 10));\n"
                    << "    }\n"
-                   << "    rOffset += sizeOfNumStr;\n"
                    << "    return 0 == errno;\n"
                    << "  }\n"
                    << "  template<typename T>\n"
@@ -390,8 +874,108 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    return 0 == memcmp(reinterpret_cast<uint8_t*>(pData), &v, sizeof(int64_t));\n"
                    << "  }\n\n"
 
+                   << "  /* Loads a network order value at pData for dispatching on literal alternatives. */\n"
+                   << "  template<typename T>\n"
+                   << "  static T peek(const uint8_t* pData)\n"
+                   << "  {\n"
+                   << "    T val;\n"
+                   << "    memcpy(&val, pData, sizeof(T));\n"
+                   << "    return networkToHost(val);\n"
+                   << "  }\n"
+                   << "  template<typename T>\n"
+                   << "  static T peek(const int8_t* pData)\n"
+                   << "  {\n"
+                   << "    return peek<T>(reinterpret_cast<const uint8_t*>(pData));\n"
+                   << "  }\n\n"
+
+                   << "  /* Unchecked loads for fixed layouts, whose length is checked once up front. */\n"
+                   << "  template<typename T>\n"
+                   << "  static void load(const uint8_t* pData, T& rValue) { rValue = peek<T>(pData); }\n"
+                   << "  template<typename T>\n"
+                   << "  static void load(const uint8_t* pData, std::vector<T>& rValue) { memcpy(rValue.data(), pData, rValue.size() * sizeof(T)); }\n"
+                   << "  template<typename T>\n"
+                   << "  static void load(const uint8_t* pData, ByteField<T>& rValue) { rValue.borrow(pData, rValue.expected()); }\n"
+                   << "  template<typename T, size_t N>\n"
+                   << "  static void load(const uint8_t* pData, BoundedVector<T, N>& rValue)\n"
+                   << "  {\n"
+                   << "    for(size_t i = 0; i < rValue.size(); ++i) rValue[i] = peek<T>(pData + i * sizeof(T));\n"
+                   << "  }\n"
+                   << "  static void load(const uint8_t* pData, std::string& rValue) { rValue.assign(reinterpret_cast<const char*>(pData), rValue.size()); }\n\n"
+
+                   << "  /* @return bytes a record of recordSize bytes lacks when only available bytes were read. */\n"
+                   << "  static size_t shortfall(size_t recordSize, size_t available) { return recordSize > available ? recordSize - available : 0; }\n\n"
+
+                   << "  /* Direct stores for marshalInto(); each returns the bytes written, which wireSize() predicts. */\n"
+                   << "  template<typename T>\n"
+                   << "  static typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type store(uint8_t* pDst, T value)\n"
+                   << "  {\n"
+                   << "    value = networkToHost(value); //Swapping is symmetric\n"
+                   << "    memcpy(pDst, &value, sizeof(T));\n"
+                   << "    return sizeof(T);\n"
+                   << "  }\n"
+                   << "  template<typename T>\n"
+                   << "  static size_t store(uint8_t* pDst, const std::vector<T>& value) { return storeItems(pDst, value); }\n"
+                   << "  template<typename T, size_t N>\n"
+                   << "  static size_t store(uint8_t* pDst, const BoundedVector<T, N>& value) { return storeItems(pDst, value); }\n"
+                   << "  template<typename T>\n"
+                   << "  static size_t store(uint8_t* pDst, const ByteField<T>& value)\n"
+                   << "  {\n"
+                   << "    memcpy(pDst, value.data(), value.size());\n"
+                   << "    return value.size();\n"
+                   << "  }\n"
+                   << "  static size_t store(uint8_t* pDst, const std::string& value)\n"
+                   << "  {\n"
+                   << "    memcpy(pDst, value.data(), value.size());\n"
+                   << "    return value.size();\n"
+                   << "  }\n"
+                   << "  template<typename T>\n"
+                   << "  static size_t storeNumString(uint8_t* pDst, T value, size_t sizeOfNumStr)\n"
+                   << "  {\n"
+                   << "    std::string valStr(std::to_string(value));\n"
+                   << "    if(valStr.length() < sizeOfNumStr)\n"
+                   << "      valStr = std::string((sizeOfNumStr - valStr.length()), '0') + valStr;\n"
+                   << "    memcpy(pDst, valStr.c_str(), sizeOfNumStr);\n"
+                   << "    return sizeOfNumStr;\n"
+                   << "  }\n"
+                   << "  /* Reads through the const data(), so a borrowed ByteField is not copied. */\n"
+                   << "  template<typename CONTAINER_T>\n"
+                   << "  static const uint8_t* wireBytes(const CONTAINER_T& value) { return reinterpret_cast<const uint8_t*>(value.data()); }\n"
+                   << "  template<typename T>\n"
+                   << "  static typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type wireSize(T) { return sizeof(T); }\n"
+                   << "  template<typename CONTAINER_T>\n"
+                   << "  static typename std::enable_if<!std::is_arithmetic<CONTAINER_T>::value, size_t>::type wireSize(const CONTAINER_T& value)\n"
+                   << "  {\n"
+                   << "    return value.size() * sizeof(*value.data());\n"
+                   << "  }\n\n"
+
+                   << "  /* Appends width bytes of a value, in host byte order, to a columnar output column. */\n"
+                   << "  static void appendColumn(std::vector<uint8_t>& rColumn, const void* pValue, size_t width)\n"
+                   << "  {\n"
+                   << "    auto pBytes = static_cast<const uint8_t*>(pValue);\n"
+                   << "    rColumn.insert(rColumn.end(), pBytes, pBytes + width);\n"
+                   << "  }\n\n"
+
                    << "private:\n"
 
+                   << "  template<typename CONTAINER_T>\n"
+                   << "  static size_t storeItems(uint8_t* pDst, const CONTAINER_T& value)\n"
+                   << "  {\n"
+                   << "    size_t len = 0;\n"
+                   << "    for(const auto& item : value) len += store(pDst + len, item);\n"
+                   << "    return len;\n"
+                   << "  }\n\n"
+
+                   << "  static uint8_t networkToHost(uint8_t val) { return val; }\n"
+                   << "  static uint16_t networkToHost(uint16_t val) { return ntohs(val); }\n"
+                   << "  static uint32_t networkToHost(uint32_t val) { return ntohl(val); }\n"
+                   << "  static uint64_t networkToHost(uint64_t val) { return ntohll(val); }\n"
+                   << "  static int8_t networkToHost(int8_t val) { return val; }\n"
+                   << "  static int16_t networkToHost(int16_t val) { return static_cast<int16_t>(ntohs(static_cast<uint16_t>(val))); }\n"
+                   << "  static int32_t networkToHost(int32_t val) { return static_cast<int32_t>(ntohl(static_cast<uint32_t>(val))); }\n"
+                   << "  static int64_t networkToHost(int64_t val) { return static_cast<int64_t>(ntohll(static_cast<uint64_t>(val))); }\n"
+                   << "  static float networkToHost(float val) { return val; } //Floats are not byte swapped, as in unmarshalFloat\n"
+                   << "  static double networkToHost(double val) { return val; }\n\n"
+
                    << "  union FloatConvert\n"
                    << "  {\n"
                    << "    float value = 0;\n"
@@ -404,8 +988,8 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "    uint8_t bytes[sizeof(double)];\n"
                    << "  };\n\n"
 
-                   << "  template<typename VEC_T, typename T>\n"
-                   << "  static T unmarshal(std::vector<VEC_T> data, size_t& rOffset, size_t diffBytes)\n"
+                   << "  template<typename T>\n"
+                   << "  static T unmarshal(const DataView& data, size_t& rOffset, size_t diffBytes)\n"
                    << "  {\n"
                    << "    size_t valSize = sizeof(T) + diffBytes;\n"
                    << "    if(valSize > data.size()) throw std::runtime_error(\"Offset > data size!\");\n"
@@ -417,12 +1001,13 @@ void Generator::generateConversionClass(const std::string& dirPath)
                    << "  template<typename VEC_T, typename T>\n"
                    << "  static void marshal(std::vector<VEC_T>& rData, size_t typeSize, T val, bool append)\n"
                    << "  {\n"
-                   << "    rData.resize(append ? rData.size() + typeSize : typeSize);\n"
-                   << "    memcpy(&rData[append ? rData.size() : 0], &val, typeSize);\n"
+                   << "    size_t offset = append ? rData.size() : 0;\n"
+                   << "    rData.resize(offset + typeSize);\n"
+                   << "    memcpy(&rData[offset], &val, typeSize);\n"
                    << "  }\n\n"
 
-                   << "  template<typename VEC_T, typename FLT_T, typename FLT_NUM_CONVERT>\n"
-                   << "  static FLT_T unmarshalFloat(std::vector<VEC_T> data, size_t& rOffset, size_t diffBytes)\n"
+                   << "  template<typename FLT_T, typename FLT_NUM_CONVERT>\n"
+                   << "  static FLT_T unmarshalFloat(const DataView& data, size_t& rOffset, size_t diffBytes)\n"
                    << "  {\n"
                    << "    size_t valSize = sizeof(FLT_T) + diffBytes;\n"
                    << "    if(valSize > data.size()) throw std::runtime_error(\"offset > data size!\");\n"
@@ -459,225 +1044,163 @@ void Generator::generateStaticVariableClass(const std::string& dirPath)
 {
   std::string hppPrefaceComment(Utils::getClassPrefaceComment(
     "StaticVariable.hpp",
-    "Implements a discriminated union based on the marshaling and unmarshaling functions in Conversion.hpp."));
+    "Implements a discriminated union of 64-bit integers, doubles and strings with native arithmetic."));
   std::ofstream staticVariableFileHpp(dirPath + "/StaticVariable.hpp", std::ios::out);
   staticVariableFileHpp
     << hppPrefaceComment
     << "#ifndef STATICVARIABLE_HPP\n"
     << "#define STATICVARIABLE_HPP\n\n"
 
-    << "#include \"Conversion.hpp\"\n"
+    << "#include <cmath>\n"
+    << "#include <cstdint>\n"
     << "#include <iostream>\n"
+    << "#include <stdexcept>\n"
+    << "#include <string>\n"
     << "#include <type_traits>\n\n"
 
-    << "#define SV_TO_SV_OP(op)                                                      \\\n"
-    << "  StaticVariable& operator op (const StaticVariable& rhs)                    \\\n"
-    << "  {                                                                          \\\n"
-    << "    if(SV_NONE == m_type && SV_NONE != rhs.getType())                        \\\n"
-    << "    {                                                                        \\\n"
-    << "      m_type = rhs.getType();                                                \\\n"
-    << "    }                                                                        \\\n"
-    << "    if(SV_FLOAT == m_type)                                                   \\\n"
-    << "    {                                                                        \\\n"
-    << "      auto thisVal = get<float>();                                           \\\n"
-    << "      auto rhsVal = rhs.get<float>();                                        \\\n"
-    << "      set(thisVal op rhsVal);                                                \\\n"
-    << "    }                                                                        \\\n"
-    << "    else if(SV_DOUBLE == m_type)                                             \\\n"
-    << "    {                                                                        \\\n"
-    << "      auto thisVal = get<double>();                                          \\\n"
-    << "      auto rhsVal = rhs.get<double>();                                       \\\n"
-    << "      set(thisVal op rhsVal);                                                \\\n"
-    << "    }                                                                        \\\n"
-    << "    else if(SV_UINT == m_type || SV_INT == m_type)                           \\\n"
-    << "    {                                                                        \\\n"
-    << "      bool isUnsigned = SV_UINT == m_type;                                   \\\n"
-    << "      if(m_typeSize == 1)                                                    \\\n"
-    << "      {                                                                      \\\n"
-    << "        auto thisVal = isUnsigned ? get<uint8_t>() : get<int8_t>();          \\\n"
-    << "        auto rhsVal = isUnsigned ? rhs.get<uint8_t>() : rhs.get<int8_t>();   \\\n"
-    << "        set(thisVal op rhsVal);                                              \\\n"
-    << "      }                                                                      \\\n"
-    << "      else if(m_typeSize == 2)                                               \\\n"
-    << "      {                                                                      \\\n"
-    << "        auto thisVal = isUnsigned ? get<uint16_t>() : get<int16_t>();        \\\n"
-    << "        auto rhsVal = isUnsigned ? rhs.get<uint16_t>() : rhs.get<int16_t>(); \\\n"
-    << "        set(thisVal op rhsVal);                                              \\\n"
-    << "      }                                                                      \\\n"
-    << "      else if(m_typeSize <= 4)                                               \\\n"
-    << "      {                                                                      \\\n"
-    << "        auto thisVal = isUnsigned ? get<uint32_t>() : get<int32_t>();        \\\n"
-    << "        auto rhsVal = isUnsigned ? rhs.get<uint32_t>() : rhs.get<int32_t>(); \\\n"
-    << "        set(thisVal op rhsVal);                                              \\\n"
-    << "      }                                                                      \\\n"
-    << "      else if(m_typeSize <= 8)                                               \\\n"
-    << "      {                                                                      \\\n"
-    << "        auto thisVal = isUnsigned ? get<uint64_t>() : get<int64_t>();        \\\n"
-    << "        auto rhsVal = isUnsigned ? rhs.get<uint64_t>() : rhs.get<int64_t>(); \\\n"
-    << "        set(thisVal op rhsVal);                                              \\\n"
-    << "      }                                                                      \\\n"
-    << "    }                                                                        \\\n"
-    << "    else                                                                     \\\n"
-    << "    {                                                                        \\\n"
-    << "      throw std::runtime_error(\"operation requires an arithmetic type\");     \\\n"
-    << "    }                                                                        \\\n"
-    << "    return *this;                                                            \\\n"
+    << "#define SV_TO_SV_OP(op)                                            \\\n"
+    << "  StaticVariable& operator op##= (const StaticVariable& rhs)       \\\n"
+    << "  {                                                                \\\n"
+    << "    switch(getArithmeticType(rhs))                                 \\\n"
+    << "    {                                                              \\\n"
+    << "    case SV_DOUBLE: set(get<double>() op rhs.get<double>()); break; \\\n"
+    << "    case SV_INT: set(get<int64_t>() op rhs.get<int64_t>()); break; \\\n"
+    << "    default: set(get<uint64_t>() op rhs.get<uint64_t>()); break;   \\\n"
+    << "    };                                                             \\\n"
+    << "    return *this;                                                  \\\n"
+    << "  }                                                                \\\n"
+    << "  StaticVariable operator op (const StaticVariable& rhs) const     \\\n"
+    << "  {                                                                \\\n"
+    << "    StaticVariable result(*this);                                  \\\n"
+    << "    return result op##= rhs;                                       \\\n"
     << "  }\n\n"
 
-    << "#define T_TO_SV_OP(op)                       \\\n"
-    << "  template<typename T>                       \\\n"
-    << "  StaticVariable& operator op (const T& rhs) \\\n"
-    << "  {                                          \\\n"
-    << "    T thisVal = get<T>();                    \\\n"
-    << "    set(thisVal op rhs);                     \\\n"
-    << "    return *this;                            \\\n"
-    << "  }\n\n"
+    << "#define T_TO_SV_OP(op)                                                                       \\\n"
+    << "  template<typename T>                                                                       \\\n"
+    << "  StaticVariable& operator op##= (const T& rhs) { return *this op##= StaticVariable(rhs); }  \\\n"
+    << "  template<typename T>                                                                       \\\n"
+    << "  StaticVariable operator op (const T& rhs) const { return *this op StaticVariable(rhs); }\n\n"
+
+    << "#define SV_COMPARE_OP(op)                                                              \\\n"
+    << "  bool operator op (const StaticVariable& rhs) const { return compare(rhs) op 0; }     \\\n"
+    << "  template<typename T>                                                                 \\\n"
+    << "  bool operator op (const T& rhs) const { return compare(StaticVariable(rhs)) op 0; }\n\n"
 
     << "class StaticVariable\n"
     << "{\n"
     << "public:\n"
+    << "  enum StaticVariableType { SV_NONE, SV_UINT, SV_INT, SV_DOUBLE, SV_STRING };\n\n"
+
     << "  StaticVariable()\n"
-    << "  : m_typeSize(0),\n"
-    << "    m_valueAsString(),\n"
-    << "    m_buffer(),\n"
-    << "    m_type(SV_NONE)\n"
-    << "  {}\n\n"
+    << "  : m_type(SV_NONE),\n"
+    << "    m_string()\n"
+    << "  {\n"
+    << "    m_value.u = 0;\n"
+    << "  }\n\n"
 
     << "  template<typename T>\n"
     << "  StaticVariable(const T& val)\n"
-    << "  : m_typeSize(0),\n"
-    << "    m_valueAsString(),\n"
-    << "    m_buffer(),\n"
-    << "    m_type(SV_NONE)\n"
+    << "  : m_type(SV_NONE),\n"
+    << "    m_string()\n"
     << "  {\n"
+    << "    m_value.u = 0;\n"
     << "    set(val);\n"
     << "  }\n\n"
 
     << "  template<typename T>\n"
     << "  void set(T val)\n"
     << "  {\n"
-    << "    m_typeSize = sizeof(val);\n"
-    << "    if(std::is_arithmetic<T>::value) m_valueAsString = std::to_string(val);\n"
-    << "    if(std::is_integral<T>()) m_type = std::is_signed<T>() ? SV_INT : SV_UINT;\n"
-    << "    Conversion::marshal(m_buffer, val, false);\n"
-    << "  }\n\n"
-
-    << "  void set(float val)\n"
-    << "  {\n"
-    << "    m_typeSize = sizeof(val);\n"
-    << "    m_valueAsString = std::to_string(val);\n"
-    << "    m_type = SV_FLOAT;\n"
-    << "    Conversion::marshal(m_buffer, val, false);\n"
-    << "  }\n\n"
-
-    << "  void set(double val)\n"
-    << "  {\n"
-    << "    m_typeSize = sizeof(val);\n"
-    << "    m_valueAsString = std::to_string(val);\n"
-    << "    m_type = SV_DOUBLE;\n"
-    << "    Conversion::marshal(m_buffer, val, false);\n"
+    << "    static_assert(std::is_arithmetic<T>::value, \"StaticVariable holds numbers and strings\");\n"
+    << "    if(std::is_floating_point<T>::value) { m_type = SV_DOUBLE; m_value.d = static_cast<double>(val); }\n"
+    << "    else if(std::is_signed<T>::value) { m_type = SV_INT; m_value.i = static_cast<int64_t>(val); }\n"
+    << "    else { m_type = SV_UINT; m_value.u = static_cast<uint64_t>(val); }\n"
     << "  }\n\n"
 
     << "  void set(const std::string& val)\n"
     << "  {\n"
-    << "    m_typeSize = val.size();\n"
-    << "    m_valueAsString = val;\n"
     << "    m_type = SV_STRING;\n"
-    << "    Conversion::marshal(m_buffer, val, false);\n"
+    << "    m_string = val; //Short strings stay in std::string's inline buffer\n"
     << "  }\n\n"
 
+    << "  void set(const char* val) { set(std::string(val)); }\n\n"
+
     << "  template<typename T>\n"
     << "  T get() const\n"
     << "  {\n"
-    << "    size_t offset = 0;\n"
     << "    switch(m_type)\n"
     << "    {\n"
-    << "    case SV_FLOAT: return unmarshalByType<T, float>(offset); break;\n"
-    << "    case SV_DOUBLE: return unmarshalByType<T, double>(offset); break;\n"
-    << "    case SV_INT:\n"
-    << "      {\n"
-    << "        if(m_typeSize == 1) return unmarshalByType<T, int8_t>(offset);\n"
-    << "        if(m_typeSize == 2) return unmarshalByType<T, int16_t>(offset);\n"
-    << "        if(m_typeSize <= 4) return unmarshalByType<T, int32_t>(offset);\n"
-    << "        if(m_typeSize <= 8) return unmarshalByType<T, int64_t>(offset);\n"
-    << "      }\n"
-    << "      break;\n"
-    << "    case SV_UINT:\n"
-    << "      {\n"
-    << "        if(m_typeSize == 1) return unmarshalByType<T, uint8_t>(offset);\n"
-    << "        if(m_typeSize == 2) return unmarshalByType<T, uint16_t>(offset);\n"
-    << "        if(m_typeSize <= 4) return unmarshalByType<T, uint32_t>(offset);\n"
-    << "        if(m_typeSize <= 8) return unmarshalByType<T, uint64_t>(offset);\n"
-    << "      }\n"
-    << "      break;\n"
+    << "    case SV_UINT: return static_cast<T>(m_value.u);\n"
+    << "    case SV_INT: return static_cast<T>(m_value.i);\n"
+    << "    case SV_DOUBLE: return static_cast<T>(m_value.d);\n"
+    << "    case SV_STRING: throw std::runtime_error(\"operation requires an arithmetic type\");\n"
+    << "    default: return static_cast<T>(0);\n"
     << "    };\n"
-    << "    T val = 0;\n"
-    << "    Conversion::unmarshal(m_buffer, val, offset);\n"
-    << "    return val;\n"
     << "  }\n\n"
 
     << "  template<typename T> operator T() const { return get<T>(); }\n\n"
 
     << "  operator double() const { return get<double>(); }\n\n"
 
-    << "  SV_TO_SV_OP(=)\n"
+    << "  template<typename T>\n"
+    << "  StaticVariable& operator=(const T& rhs)\n"
+    << "  {\n"
+    << "    set(rhs);\n"
+    << "    return *this;\n"
+    << "  }\n\n"
+
     << "  SV_TO_SV_OP(+)\n"
-    << "  SV_TO_SV_OP(+=)\n"
     << "  SV_TO_SV_OP(-)\n"
-    << "  SV_TO_SV_OP(-=)\n"
     << "  SV_TO_SV_OP(*)\n"
-    << "  SV_TO_SV_OP(*=)\n"
-    << "  SV_TO_SV_OP(/)\n"
-    << "  SV_TO_SV_OP(/=)\n\n"
+    << "  SV_TO_SV_OP(/)\n\n"
+
+    << "  StaticVariable& operator%=(const StaticVariable& rhs)\n"
+    << "  {\n"
+    << "    switch(getArithmeticType(rhs))\n"
+    << "    {\n"
+    << "    case SV_DOUBLE: set(std::fmod(get<double>(), rhs.get<double>())); break;\n"
+    << "    case SV_INT: set(get<int64_t>() % rhs.get<int64_t>()); break;\n"
+    << "    default: set(get<uint64_t>() % rhs.get<uint64_t>()); break;\n"
+    << "    };\n"
+    << "    return *this;\n"
+    << "  }\n\n"
+
+    << "  StaticVariable operator%(const StaticVariable& rhs) const\n"
+    << "  {\n"
+    << "    StaticVariable result(*this);\n"
+    << "    return result %= rhs;\n"
+    << "  }\n\n"
 
-    << "  T_TO_SV_OP(=)\n"
     << "  T_TO_SV_OP(+)\n"
-    << "  T_TO_SV_OP(+=)\n"
     << "  T_TO_SV_OP(-)\n"
-    << "  T_TO_SV_OP(-=)\n"
     << "  T_TO_SV_OP(*)\n"
-    << "  T_TO_SV_OP(*=)\n"
     << "  T_TO_SV_OP(/)\n"
-    << "  T_TO_SV_OP(/=)\n"
-    << "  T_TO_SV_OP(%)\n"
-    << "  T_TO_SV_OP(%=)\n\n"
+    << "  T_TO_SV_OP(%)\n\n"
+
+    << "  SV_COMPARE_OP(==)\n"
+    << "  SV_COMPARE_OP(!=)\n"
+    << "  SV_COMPARE_OP(<)\n"
+    << "  SV_COMPARE_OP(<=)\n"
+    << "  SV_COMPARE_OP(>)\n"
+    << "  SV_COMPARE_OP(>=)\n\n"
 
-    << "  StaticVariable operator++()\n"
+    << "  StaticVariable& operator++()\n"
     << "  {\n"
-    << "    switch(m_type)\n"
-    << "    {\n"
-    << "    case SV_FLOAT:\n"
-    << "    case SV_DOUBLE: *this += 1.0f; break;\n"
-    << "    case SV_INT:\n"
-    << "    case SV_UINT: *this += 1; break;\n"
-    << "    default: throw std::runtime_error(\"operation requires an arithmetic type\"); break;\n"
-    << "    };\n"
-    << "    return *this;\n"
+    << "    return *this += StaticVariable(1);\n"
     << "  }\n\n"
 
-    << "  template<typename T>\n"
-    << "  StaticVariable operator++(T)\n"
+    << "  StaticVariable operator++(int)\n"
     << "  {\n"
     << "    StaticVariable temp(*this);\n"
     << "    operator++();\n"
     << "    return temp;\n"
     << "  }\n\n"
 
-    << "  StaticVariable operator--()\n"
+    << "  StaticVariable& operator--()\n"
     << "  {\n"
-    << "    switch(m_type)\n"
-    << "    {\n"
-    << "    case SV_FLOAT:\n"
-    << "    case SV_DOUBLE: *this -= 1.0f; break;\n"
-    << "    case SV_INT:\n"
-    << "    case SV_UINT: *this -= 1; break;\n"
-    << "    default: throw std::runtime_error(\"operation requires an arithmetic type\"); break;\n"
-    << "    };\n"
-    << "    return *this;\n"
+    << "    return *this -= StaticVariable(1);\n"
     << "  }\n\n"
 
-    << "  template<typename T>\n"
-    << "  StaticVariable operator--(T)\n"
+    << "  StaticVariable operator--(int)\n"
     << "  {\n"
     << "    StaticVariable temp(*this);\n"
     << "    operator--();\n"
@@ -686,25 +1209,60 @@ void Generator::generateStaticVariableClass(const std::string& dirPath)
 
     << "  friend std::ostream& operator<<(std::ostream& os, const StaticVariable& rhs);\n\n"
 
-    << "  enum StaticVariableType { SV_NONE, SV_UINT, SV_INT, SV_FLOAT, SV_DOUBLE, SV_STRING };\n"
     << "  StaticVariableType getType() const { return m_type; }\n"
-    << "  std::string to_string() const { return m_valueAsString; }\n\n"
-  
+    << "  /** Formats the value; done only when printed, never on assignment. */\n"
+    << "  std::string to_string() const\n"
+    << "  {\n"
+    << "    switch(m_type)\n"
+    << "    {\n"
+    << "    case SV_UINT: return std::to_string(m_value.u);\n"
+    << "    case SV_INT: return std::to_string(m_value.i);\n"
+    << "    case SV_DOUBLE: return std::to_string(m_value.d);\n"
+    << "    case SV_STRING: return m_string;\n"
+    << "    default: return std::string();\n"
+    << "    };\n"
+    << "  }\n\n"
+
     << "private:\n"
+    << "  /** @return the type an arithmetic result takes: doubles win, otherwise the left side's integer type. */\n"
+    << "  StaticVariableType getArithmeticType(const StaticVariable& rhs) const\n"
+    << "  {\n"
+    << "    if(SV_STRING == m_type || SV_STRING == rhs.m_type)\n"
+    << "      throw std::runtime_error(\"operation requires an arithmetic type\");\n"
+    << "    if(SV_DOUBLE == m_type || SV_DOUBLE == rhs.m_type) return SV_DOUBLE;\n"
+    << "    if(SV_NONE != m_type) return m_type;\n"
+    << "    return SV_NONE != rhs.m_type ? rhs.m_type : SV_INT;\n"
+    << "  }\n\n"
 
-    << "  template<typename RET_T, typename FROM_T>\n"
-    << "  RET_T unmarshalByType(size_t& rOffset) const\n"
+    << "  /** @return negative, zero or positive as this is less than, equal to or greater than rhs. */\n"
+    << "  int compare(const StaticVariable& rhs) const\n"
     << "  {\n"
-    << "    FROM_T value = 0;\n"
-    << "    Conversion::unmarshal(m_buffer, value, rOffset);\n"
-    << "    return static_cast<RET_T>(value);\n"
+    << "    if(SV_STRING == m_type || SV_STRING == rhs.m_type)\n"
+    << "      return to_string().compare(rhs.to_string());\n"
+    << "    if(SV_DOUBLE == m_type || SV_DOUBLE == rhs.m_type)\n"
+    << "    {\n"
+    << "      double lhsVal = get<double>(), rhsVal = rhs.get<double>();\n"
+    << "      return lhsVal < rhsVal ? -1 : (rhsVal < lhsVal ? 1 : 0);\n"
+    << "    }\n"
+    << "    //Negative signed values sort below every unsigned value\n"
+    << "    bool isLhsNegative = SV_INT == m_type && m_value.i < 0;\n"
+    << "    bool isRhsNegative = SV_INT == rhs.m_type && rhs.m_value.i < 0;\n"
+    << "    if(isLhsNegative != isRhsNegative) return isLhsNegative ? -1 : 1;\n"
+    << "    if(isLhsNegative)\n"
+    << "      return m_value.i < rhs.m_value.i ? -1 : (rhs.m_value.i < m_value.i ? 1 : 0);\n"
+    << "    uint64_t lhsVal = get<uint64_t>(), rhsVal = rhs.get<uint64_t>();\n"
+    << "    return lhsVal < rhsVal ? -1 : (rhsVal < lhsVal ? 1 : 0);\n"
     << "  }\n\n"
 
     << "private:\n"
-    << "  size_t m_typeSize;\n"
-    << "  std::string m_valueAsString;\n"
     << "  StaticVariableType m_type;\n"
-    << "  std::vector<uint8_t> m_buffer;\n"
+    << "  union\n"
+    << "  {\n"
+    << "    uint64_t u;\n"
+    << "    int64_t i;\n"
+    << "    double d;\n"
+    << "  } m_value;\n"
+    << "  std::string m_string;\n"
     << "};\n\n"
 
     << "#endif //STATICVARIABLE_HPP\n\n";
@@ -718,11 +1276,531 @@ void Generator::generateStaticVariableClass(const std::string& dirPath)
     << "#include \"StaticVariable.hpp\"\n\n"
     << "std::ostream& operator<<(std::ostream& os, const StaticVariable& rhs)\n"
     << "{\n"
-    << "  os << rhs.to_string();\n"
+    << "  switch(rhs.m_type)\n"
+    << "  {\n"
+    << "  case StaticVariable::SV_UINT: os << rhs.m_value.u; break;\n"
+    << "  case StaticVariable::SV_INT: os << rhs.m_value.i; break;\n"
+    << "  case StaticVariable::SV_STRING: os << rhs.m_string; break;\n"
+    << "  default: os << rhs.to_string(); break;\n"
+    << "  };\n"
     << "  return os;\n"
     << "}\n\n";
 }
 
+void Generator::generateRuntimeConfigClass(const std::string& dirPath, const std::string& appName)
+{
+  try
+  {
+    std::ostringstream defaults;
+    std::string settings;
+    for(const auto& rOption : m_runtimeOptions)
+    {
+      std::string setting(rOption.first.substr(rOption.first.find('.') + 1));
+      if("cpus" != setting && "priority" != setting && "mlockall" != setting && "prefault_bytes" != setting && "workers" != setting)
+        Utils::Logger::logWarn("Unknown runtime setting \"" + rOption.first + "\" is generated but not used");
+      defaults << "    m_values[\"" << rOption.first << "\"] = \"" << rOption.second << "\";\n";
+      settings.append(rOption.first + " = " + rOption.second + "\n");
+    }
+    std::ofstream configFileHpp(dirPath + "/RuntimeConfig.hpp", std::ios::out);
+    configFileHpp << Utils::getClassPrefaceComment(
+      "RuntimeConfig.hpp",
+      "Reads the settings that pin, prioritize and lock the memory of the state table threads.")
+      << "#ifndef RUNTIMECONFIG_HPP\n"
+      << "#define RUNTIMECONFIG_HPP\n\n"
+
+      << "#include <algorithm>\n"
+      << "#include <cerrno>\n"
+      << "#include <cstdlib>\n"
+      << "#include <cstring>\n"
+      << "#include <fstream>\n"
+      << "#include <iostream>\n"
+      << "#include <map>\n"
+      << "#include <sstream>\n"
+      << "#include <string>\n"
+      << "#include <thread>\n"
+      << "#include <vector>\n"
+      << "#if defined(__linux__)\n"
+      << "#include <pthread.h>\n"
+      << "#include <sched.h>\n"
+      << "#include <sys/mman.h>\n"
+      << "#endif\n\n"
+
+      << "/*\n"
+      << " * Settings are name = value lines and # starts a comment:\n"
+      << " *   cpus = 2,3           CPUs of the state table threads; shard n runs on the nth, wrapping around\n"
+      << " *   priority = 80        SCHED_FIFO priority of the state table threads, 1 to 99\n"
+      << " *   mlockall = 1         Locks all current and future pages in memory\n"
+      << " *   prefault_bytes = 0   Bytes of each UDP receive buffer touched before the first read\n"
+      << " *   workers = 4          Threads that run sessions, if the application was generated with sessions\n"
+      << " * <state table>.cpus and <state table>.priority apply to one state table, e.g. Relay.cpus = 4,\n"
+      << " * and SessionScheduler.cpus and SessionScheduler.priority to the session threads.\n"
+      << " */\n"
+      << "class RuntimeConfig\n"
+      << "{\n"
+      << "public:\n"
+      << "  static RuntimeConfig& get() { static RuntimeConfig s_config; return s_config; }\n\n"
+
+      << "  /* Reads a settings file before any state table starts. A missing file keeps the built-in settings. */\n"
+      << "  void load(const std::string& filePath)\n"
+      << "  {\n"
+      << "    std::ifstream file(filePath);\n"
+      << "    std::string line;\n"
+      << "    while(std::getline(file, line))\n"
+      << "    {\n"
+      << "      line = line.substr(0, line.find('#'));\n"
+      << "      auto equals = line.find('=');\n"
+      << "      if(std::string::npos == equals)\n"
+      << "        continue;\n"
+      << "      std::string name(trim(line.substr(0, equals)));\n"
+      << "      if(!name.empty())\n"
+      << "        m_values[name] = trim(line.substr(equals + 1));\n"
+      << "    }\n"
+      << "  }\n\n"
+
+      << "  std::string getValue(const std::string& name, const std::string& defaultValue = std::string()) const\n"
+      << "  {\n"
+      << "    auto valueIt = m_values.find(name);\n"
+      << "    return m_values.end() != valueIt ? valueIt->second : defaultValue;\n"
+      << "  }\n\n"
+
+      << "  /* @return the bytes of each receive buffer to touch before the first read. */\n"
+      << "  size_t getPrefaultBytes() const { return static_cast<size_t>(std::strtoull(getValue(\"prefault_bytes\", \"0\").c_str(), nullptr, 10)); }\n\n"
+      << "  /* @return the threads that run sessions, one per core unless workers is set. */\n"
+      << "  size_t getWorkerCount() const\n"
+      << "  {\n"
+      << "    size_t workerCount = static_cast<size_t>(std::strtoull(getValue(\"workers\", \"0\").c_str(), nullptr, 10));\n"
+      << "    return workerCount > 0 ? workerCount : std::max(1u, std::thread::hardware_concurrency());\n"
+      << "  }\n\n"
+
+      << "  /* Locks the pages of the process in memory if mlockall is set, so they are never paged out. */\n"
+      << "  void lockMemory() const\n"
+      << "  {\n"
+      << "    if(\"1\" != getValue(\"mlockall\") && \"true\" != getValue(\"mlockall\"))\n"
+      << "      return;\n"
+      << "#if defined(__linux__)\n"
+      << "    if(0 != mlockall(MCL_CURRENT | MCL_FUTURE))\n"
+      << "      warn(\"Could not lock memory\", errno);\n"
+      << "#else\n"
+      << "    std::cerr << \"Memory is only locked on Linux\" << std::endl;\n"
+      << "#endif\n"
+      << "  }\n\n"
+
+      << "  /* Pins the calling state table thread to a CPU and sets its SCHED_FIFO priority. */\n"
+      << "  void applyThreadSettings(const std::string& stateTable, size_t shard) const\n"
+      << "  {\n"
+      << "    std::string cpus(getValue(stateTable + \".cpus\", getValue(\"cpus\")));\n"
+      << "    int priority = std::atoi(getValue(stateTable + \".priority\", getValue(\"priority\", \"0\")).c_str());\n"
+      << "#if defined(__linux__)\n"
+      << "    std::vector<int> cpuList;\n"
+      << "    std::istringstream cpuStream(cpus);\n"
+      << "    for(std::string cpu; std::getline(cpuStream, cpu, ',');)\n"
+      << "      if(!trim(cpu).empty())\n"
+      << "        cpuList.push_back(std::atoi(cpu.c_str()));\n"
+      << "    if(!cpuList.empty())\n"
+      << "    {\n"
+      << "      cpu_set_t cpuSet;\n"
+      << "      CPU_ZERO(&cpuSet);\n"
+      << "      CPU_SET(cpuList[shard % cpuList.size()], &cpuSet);\n"
+      << "      int error = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);\n"
+      << "      if(0 != error)\n"
+      << "        warn(stateTable + \" could not be pinned to its CPU\", error);\n"
+      << "    }\n"
+      << "    if(priority > 0)\n"
+      << "    {\n"
+      << "      sched_param param = {};\n"
+      << "      param.sched_priority = priority;\n"
+      << "      int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);\n"
+      << "      if(0 != error)\n"
+      << "        warn(stateTable + \" could not be given its priority\", error);\n"
+      << "    }\n"
+      << "#else\n"
+      << "    if(!cpus.empty() || priority > 0)\n"
+      << "      std::cerr << stateTable << \" shard \" << shard << \": CPUs and priorities are only set on Linux\" << std::endl;\n"
+      << "#endif\n"
+      << "  }\n\n"
+
+      << "private:\n"
+      << "  RuntimeConfig() : m_values()\n"
+      << "  {\n"
+      << defaults.str()
+      << "  }\n\n"
+
+      << "  static std::string trim(const std::string& text)\n"
+      << "  {\n"
+      << "    auto first = text.find_first_not_of(\" \\t\\r\");\n"
+      << "    if(std::string::npos == first)\n"
+      << "      return std::string();\n"
+      << "    return text.substr(first, text.find_last_not_of(\" \\t\\r\") - first + 1);\n"
+      << "  }\n\n"
+
+      << "  static void warn(const std::string& message, int error)\n"
+      << "  {\n"
+      << "    std::cerr << message << \": \" << std::strerror(error) << std::endl;\n"
+      << "  }\n\n"
+
+      << "  std::map<std::string, std::string> m_values;\n"
+      << "};\n\n"
+
+      << "#endif //RUNTIMECONFIG_HPP\n";
+    configFileHpp.close();
+
+    //A settings file to edit per deployment, starting from the built-in settings.
+    std::ofstream configFile(dirPath + "/" + appName + ".conf", std::ios::out);
+    configFile << "# Runtime settings of " << appName << ", read from the path given as its first argument or from "
+               << appName << ".conf.\n"
+               << "# They override the settings the application was generated with.\n"
+               << "#\n"
+               << "# cpus = 2,3           CPUs of the state table threads; shard n runs on the nth, wrapping around\n"
+               << "# priority = 80        SCHED_FIFO priority of the state table threads, 1 to 99 (needs CAP_SYS_NICE)\n"
+               << "# mlockall = 1         Locks all current and future pages in memory (needs CAP_IPC_LOCK)\n"
+               << "# prefault_bytes = 0   Bytes of each UDP receive buffer touched before the first read\n"
+               << "# workers = 4          Threads that run sessions, if the application was generated with sessions\n"
+               << "# <state table>.cpus and <state table>.priority apply to one state table, e.g. Relay.cpus = 4,\n"
+               << "# and SessionScheduler.cpus and SessionScheduler.priority to the session threads\n"
+               << settings;
+    configFile.close();
+  }
+  catch(const std::exception& ex)
+  {
+    Utils::Logger::logErr("An error occurred while writing RuntimeConfig.hpp: " + std::string(ex.what()));
+  }
+  catch(...)
+  {
+    Utils::Logger::logErr("An unknown error occurred while writing RuntimeConfig.hpp");
+  }
+}
+
+void Generator::generateSessionSchedulerClass(const std::string& dirPath)
+{
+  try
+  {
+    std::ofstream schedulerFile(dirPath + "/SessionScheduler.hpp", std::ios::out);
+    schedulerFile << Utils::getClassPrefaceComment(
+      "SessionScheduler.hpp",
+      "Runs many state table sessions on a few threads, resuming each when its events are ready.")
+      << "#ifndef SESSIONSCHEDULER_HPP\n"
+      << "#define SESSIONSCHEDULER_HPP\n\n"
+
+      << "#include <algorithm>\n"
+      << "#include <atomic>\n"
+      << "#include <chrono>\n"
+      << "#include <cstdint>\n"
+      << "#include <exception>\n"
+      << "#include <iostream>\n"
+      << "#include <memory>\n"
+      << "#include <mutex>\n"
+      << "#include <system_error>\n"
+      << "#include <thread>\n"
+      << "#include <vector>\n"
+      << "#if defined(__linux__)\n"
+      << "#include <cerrno>\n"
+      << "#include <sys/epoll.h>\n"
+      << "#include <sys/eventfd.h>\n"
+      << "#include <unistd.h>\n"
+      << "#endif\n"
+      << "#include \"RuntimeConfig.hpp\"\n\n"
+
+      << "/* A state table instance that runs a few states each time a scheduler thread resumes it. */\n"
+      << "class Session\n"
+      << "{\n"
+      << "public:\n"
+      << "  enum Status\n"
+      << "  {\n"
+      << "    SESSION_WAITING,  //Resume once an input it registered is readable\n"
+      << "    SESSION_TICK,     //Resume after the worker's next tick, to rerun an idle condition state\n"
+      << "    SESSION_RUNNABLE, //Resume after the other sessions had a turn\n"
+      << "    SESSION_STOPPED\n"
+      << "  };\n"
+      << "  /* Identifies a session's input in the epoll of the worker that runs it. */\n"
+      << "  struct Event\n"
+      << "  {\n"
+      << "    Session* pSession;\n"
+      << "    uint64_t event;\n"
+      << "  };\n"
+      << "  static const uint64_t TICK_EVENT = 65;\n"
+      << "  virtual ~Session() {}\n"
+      << "  /* Registers the session's inputs, each as an Event, in the epoll of the worker thread that runs it. */\n"
+      << "  virtual void attach(int epollFd) = 0;\n"
+      << "  /* Removes the session's inputs from the worker's epoll once it has stopped. */\n"
+      << "  virtual void detach() = 0;\n"
+      << "  /* Notes an input the worker found readable, or TICK_EVENT. */\n"
+      << "  virtual void notify(uint64_t event) = 0;\n"
+      << "  /* Runs states until one has to wait, or until the others are due a turn. */\n"
+      << "  virtual Status resume() = 0;\n"
+      << "  virtual void stop() = 0;\n"
+      << "};\n\n"
+
+      << "/*\n"
+      << " * Each worker thread owns a share of the sessions and one epoll, in which the\n"
+      << " * sessions register their inputs directly, so a session holds no thread and no\n"
+      << " * descriptor of its own while it waits. Idle sessions are rerun on a 1 ms tick\n"
+      << " * that the worker's epoll_wait() timeout provides.\n"
+      << " */\n"
+      << "class SessionScheduler\n"
+      << "{\n"
+      << "public:\n"
+      << "  explicit SessionScheduler(size_t workerCount)\n"
+      << "  : m_isClosed(false),\n"
+      << "    m_isStopped(false),\n"
+      << "    m_mutex(),\n"
+      << "    m_sessions(),\n"
+      << "    m_workers()\n"
+      << "  {\n"
+      << "    for(size_t i = 0; i < workerCount || m_workers.empty(); ++i)\n"
+      << "    {\n"
+      << "      m_workers.emplace_back(new Worker());\n"
+      << "#if defined(__linux__)\n"
+      << "      m_workers.back()->epollFd = epoll_create1(EPOLL_CLOEXEC);\n"
+      << "      m_workers.back()->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);\n"
+      << "      if(m_workers.back()->epollFd < 0 || m_workers.back()->wakeFd < 0)\n"
+      << "        throw std::system_error(errno, std::system_category(), \"Error creating session scheduler\");\n"
+      << "      epoll_event ev = {};\n"
+      << "      ev.events = EPOLLIN;\n"
+      << "      ev.data.ptr = nullptr;\n"
+      << "      if(epoll_ctl(m_workers.back()->epollFd, EPOLL_CTL_ADD, m_workers.back()->wakeFd, &ev) < 0)\n"
+      << "        throw std::system_error(errno, std::system_category(), \"Error creating session scheduler\");\n"
+      << "#endif\n"
+      << "      m_workers.back()->thread = std::thread(&SessionScheduler::run, this, i);\n"
+      << "    }\n"
+      << "  }\n\n"
+
+      << "  /* Stops the sessions if wait() was not reached, e.g. after an error. */\n"
+      << "  ~SessionScheduler()\n"
+      << "  {\n"
+      << "    if(!m_isClosed)\n"
+      << "      stop();\n"
+      << "    join();\n"
+      << "#if defined(__linux__)\n"
+      << "    for(auto& rpWorker : m_workers)\n"
+      << "    {\n"
+      << "      close(rpWorker->wakeFd);\n"
+      << "      close(rpWorker->epollFd);\n"
+      << "    }\n"
+      << "#endif\n"
+      << "  }\n\n"
+
+      << "  /* Takes a session and runs it on thread index % workers, so sessions with the same index share a thread. */\n"
+      << "  void add(Session* pSession, size_t index)\n"
+      << "  {\n"
+      << "    std::unique_ptr<Session> pOwned(pSession);\n"
+      << "    Worker& rWorker = *m_workers[index % m_workers.size()];\n"
+      << "    {\n"
+      << "      std::lock_guard<std::mutex> lock(m_mutex);\n"
+      << "      m_sessions.push_back(std::move(pOwned));\n"
+      << "      rWorker.added.push_back(pSession);\n"
+      << "    }\n"
+      << "    wake(rWorker);\n"
+      << "  }\n\n"
+
+      << "  /* Stops every session; wait() returns once they have. */\n"
+      << "  void stop()\n"
+      << "  {\n"
+      << "    {\n"
+      << "      std::lock_guard<std::mutex> lock(m_mutex);\n"
+      << "      for(auto& rpSession : m_sessions)\n"
+      << "        rpSession->stop();\n"
+      << "      m_isStopped = true;\n"
+      << "    }\n"
+      << "    for(auto& rpWorker : m_workers)\n"
+      << "      wake(*rpWorker);\n"
+      << "  }\n\n"
+
+      << "  /* @return true once the sessions were stopped, e.g. because a worker thread failed. */\n"
+      << "  bool isStopped() const { return m_isStopped; }\n\n"
+
+      << "  /* Blocks until every session has stopped, then rethrows the error a worker thread failed with, if any. */\n"
+      << "  void wait()\n"
+      << "  {\n"
+      << "    join();\n"
+      << "    for(auto& rpWorker : m_workers)\n"
+      << "    {\n"
+      << "      if(rpWorker->pError)\n"
+      << "      {\n"
+      << "        std::exception_ptr pError = rpWorker->pError;\n"
+      << "        rpWorker->pError = nullptr;\n"
+      << "        std::rethrow_exception(pError);\n"
+      << "      }\n"
+      << "    }\n"
+      << "  }\n\n"
+
+      << "private:\n"
+      << "  struct Worker\n"
+      << "  {\n"
+      << "    Worker() : epollFd(-1), wakeFd(-1), added(), thread(), pError() {}\n"
+      << "    int epollFd; //Every input of the worker's sessions, and wakeFd\n"
+      << "    int wakeFd; //eventfd written when sessions are added or stopped, or the scheduler closes\n"
+      << "    std::vector<Session*> added;\n"
+      << "    std::thread thread;\n"
+      << "    std::exception_ptr pError; //What ended the thread, for wait() to rethrow\n"
+      << "  };\n\n"
+
+      << "  void join()\n"
+      << "  {\n"
+      << "    m_isClosed = true;\n"
+      << "    for(auto& rpWorker : m_workers)\n"
+      << "    {\n"
+      << "      wake(*rpWorker);\n"
+      << "      if(rpWorker->thread.joinable())\n"
+      << "        rpWorker->thread.join();\n"
+      << "    }\n"
+      << "  }\n\n"
+
+      << "  void wake(Worker& rWorker)\n"
+      << "  {\n"
+      << "#if defined(__linux__)\n"
+      << "    uint64_t one = 1;\n"
+      << "    ssize_t written = ::write(rWorker.wakeFd, &one, sizeof(one));\n"
+      << "    (void)written;\n"
+      << "#else\n"
+      << "    (void)rWorker;\n"
+      << "#endif\n"
+      << "  }\n\n"
+
+      << "  /* Resumes the session and records what it waits for. @return false once it has stopped. */\n"
+      << "  bool resume(Session* pSession, std::vector<Session*>& rRunnable, std::vector<Session*>& rTicking)\n"
+      << "  {\n"
+      << "    switch(pSession->resume())\n"
+      << "    {\n"
+      << "    case Session::SESSION_RUNNABLE:\n"
+      << "      rRunnable.push_back(pSession);\n"
+      << "      break;\n"
+      << "    case Session::SESSION_TICK:\n"
+      << "      if(rTicking.end() == std::find(rTicking.begin(), rTicking.end(), pSession))\n"
+      << "        rTicking.push_back(pSession);\n"
+      << "      break;\n"
+      << "    case Session::SESSION_STOPPED:\n"
+      << "      pSession->detach();\n"
+      << "      return false;\n"
+      << "    default:\n"
+      << "      break;\n"
+      << "    }\n"
+      << "    return true;\n"
+      << "  }\n\n"
+
+      << "  /* Runs the worker's sessions; an error stops every session and is kept for wait(). */\n"
+      << "  void run(size_t workerIndex)\n"
+      << "  {\n"
+      << "    Worker& rWorker = *m_workers[workerIndex];\n"
+      << "    try\n"
+      << "    {\n"
+      << "      runSessions(rWorker, workerIndex);\n"
+      << "    }\n"
+      << "    catch(const std::exception& ex)\n"
+      << "    {\n"
+      << "      std::cerr << \"An error occurred in session worker \" << workerIndex << \": \" << ex.what() << std::endl;\n"
+      << "      rWorker.pError = std::current_exception();\n"
+      << "      stop();\n"
+      << "    }\n"
+      << "    catch(...)\n"
+      << "    {\n"
+      << "      std::cerr << \"An unknown error occurred in session worker \" << workerIndex << std::endl;\n"
+      << "      rWorker.pError = std::current_exception();\n"
+      << "      stop();\n"
+      << "    }\n"
+      << "  }\n\n"
+
+      << "  void runSessions(Worker& rWorker, size_t workerIndex)\n"
+      << "  {\n"
+      << "    RuntimeConfig::get().applyThreadSettings(\"SessionScheduler\", workerIndex);\n"
+      << "    std::vector<Session*> sessions; //Not yet stopped\n"
+      << "    std::vector<Session*> runnable;\n"
+      << "    std::vector<Session*> ticking;\n"
+      << "    std::vector<Session*> resuming;\n"
+      << "    std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();\n"
+      << "    bool isStopSeen = false;\n"
+      << "    while(true)\n"
+      << "    {\n"
+      << "      bool isClosed = m_isClosed;\n"
+      << "      {\n"
+      << "        //New sessions run once, then when their inputs are ready\n"
+      << "        std::lock_guard<std::mutex> lock(m_mutex);\n"
+      << "        for(Session* pSession : rWorker.added)\n"
+      << "        {\n"
+      << "#if defined(__linux__)\n"
+      << "          pSession->attach(rWorker.epollFd);\n"
+      << "#endif\n"
+      << "          sessions.push_back(pSession);\n"
+      << "          runnable.push_back(pSession);\n"
+      << "        }\n"
+      << "        rWorker.added.clear();\n"
+      << "        //Stopped sessions wait for nothing, so each runs once more to see it\n"
+      << "        if(m_isStopped && !isStopSeen)\n"
+      << "        {\n"
+      << "          isStopSeen = true;\n"
+      << "          runnable = sessions;\n"
+      << "          ticking.clear();\n"
+      << "        }\n"
+      << "      }\n"
+      << "      resuming.swap(runnable);\n"
+      << "      for(Session* pSession : resuming)\n"
+      << "      {\n"
+      << "        if(!resume(pSession, runnable, ticking))\n"
+      << "          sessions.erase(std::find(sessions.begin(), sessions.end(), pSession));\n"
+      << "      }\n"
+      << "      resuming.clear();\n"
+      << "      if(sessions.empty() && isClosed)\n"
+      << "        break;\n"
+      << "      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();\n"
+      << "      if(!ticking.empty() && now >= nextTick)\n"
+      << "      {\n"
+      << "        for(Session* pSession : ticking)\n"
+      << "        {\n"
+      << "          pSession->notify(Session::TICK_EVENT);\n"
+      << "          runnable.push_back(pSession);\n"
+      << "        }\n"
+      << "        ticking.clear();\n"
+      << "        nextTick = now + std::chrono::milliseconds(1);\n"
+      << "      }\n"
+      << "#if defined(__linux__)\n"
+      << "      int timeout = !runnable.empty() ? 0 : ticking.empty() ? -1 : 1;\n"
+      << "      epoll_event events[64];\n"
+      << "      int count = epoll_wait(rWorker.epollFd, events, 64, timeout);\n"
+      << "      if(count < 0 && EINTR != errno)\n"
+      << "        throw std::system_error(errno, std::system_category(), \"Error waiting for sessions\");\n"
+      << "      for(int i = 0; i < count; ++i)\n"
+      << "      {\n"
+      << "        Session::Event* pEvent = static_cast<Session::Event*>(events[i].data.ptr);\n"
+      << "        if(!pEvent)\n"
+      << "        {\n"
+      << "          uint64_t wakes = 0;\n"
+      << "          ssize_t readLen = ::read(rWorker.wakeFd, &wakes, sizeof(wakes));\n"
+      << "          (void)readLen;\n"
+      << "          continue;\n"
+      << "        }\n"
+      << "        pEvent->pSession->notify(pEvent->event);\n"
+      << "        if(runnable.end() == std::find(runnable.begin(), runnable.end(), pEvent->pSession))\n"
+      << "          runnable.push_back(pEvent->pSession);\n"
+      << "      }\n"
+      << "#else\n"
+      << "      //Without epoll every session is resumed in turn\n"
+      << "      runnable.insert(runnable.end(), ticking.begin(), ticking.end());\n"
+      << "      ticking.clear();\n"
+      << "      if(runnable.empty())\n"
+      << "        std::this_thread::yield();\n"
+      << "#endif\n"
+      << "    }\n"
+      << "  }\n\n"
+
+      << "  std::atomic<bool> m_isClosed; //No more sessions are added\n"
+      << "  std::atomic<bool> m_isStopped;\n"
+      << "  std::mutex m_mutex;\n"
+      << "  std::vector<std::unique_ptr<Session> > m_sessions;\n"
+      << "  std::vector<std::unique_ptr<Worker> > m_workers;\n"
+      << "};\n\n"
+
+      << "#endif //SESSIONSCHEDULER_HPP\n";
+    schedulerFile.close();
+  }
+  catch(const std::exception& ex)
+  {
+    Utils::Logger::logErr("An error occurred while writing SessionScheduler.hpp: " + std::string(ex.what()));
+  }
+  catch(...)
+  {
+    Utils::Logger::logErr("An unknown error occurred while writing SessionScheduler.hpp");
+  }
+}
+
 void Generator::generateClangFormatFile(const std::string& dirPath)
 {
   try
@@ -799,7 +1877,10 @@ void Generator::generateCMakelists(const std::string& dirPath, const std::string
       << Utils::getTabSpace() << appName << "_Main" << ".cpp\n"
       << Utils::getTabSpace() << "Conversion.hpp\n"
       << Utils::getTabSpace() << "StaticVariable.cpp\n"
-      << Utils::getTabSpace() << "StaticVariable.hpp\n";
+      << Utils::getTabSpace() << "StaticVariable.hpp\n"
+      << Utils::getTabSpace() << "RuntimeConfig.hpp\n";
+    if(isSessionScheduled())
+      cmakeFile << Utils::getTabSpace() << "SessionScheduler.hpp\n";
     std::set<std::string> fileNames;
     for(std::shared_ptr<Element> pElement : Elements::elements())
     {
@@ -11,14 +11,32 @@ class Generator
 {
 public:
   static void generate(const std::string& dirPath, const std::string& appName);
+  /** Sets how many copies of each state table run, each with its own element instances. */
+  static void setShardCount(size_t shardCount) { m_shardCount = shardCount; }
+  static size_t getShardCount() { return m_shardCount; }
+  static bool isSharded() { return m_shardCount > 1 || m_isSessionScheduled; }
+  /** Runs the shards of each state table as sessions that a few scheduler threads resume, instead of a thread each. */
+  static void setSessionScheduled(bool isSessionScheduled) { m_isSessionScheduled = isSessionScheduled; }
+  static bool isSessionScheduled() { return m_isSessionScheduled; }
+  /** Defines ACTIONS in their headers as noexcept templates the state tables can inline, instead of out of line with try/catch. */
+  static void setInlineActions(bool isInlineActions) { m_isInlineActions = isInlineActions; }
+  static bool isInlineActions() { return m_isInlineActions; }
+  /** Builds a runtime setting, e.g. Relay.cpus=2,3, into the generated application as its default. */
+  static void setRuntimeOption(const std::string& name, const std::string& value) { m_runtimeOptions[name] = value; }
 private:
   static void generateConversionClass(const std::string& dirPath);
   static void generateStaticVariableClass(const std::string& dirPath);
+  static void generateRuntimeConfigClass(const std::string& dirPath, const std::string& appName);
+  static void generateSessionSchedulerClass(const std::string& dirPath);
   static void generateClangFormatFile(const std::string& dirPath);
   static void generateCMakelists(const std::string& dirPath, const std::string& appName);
   static void generateReport();
   static void reportGeneratedElementFile(const std::string& elementName, const std::string& generatedFileName);
   static std::map<std::string, std::vector<std::string> > m_elementFilesPerElementMap;
+  static size_t m_shardCount;
+  static bool m_isSessionScheduled;
+  static bool m_isInlineActions;
+  static std::map<std::string, std::string> m_runtimeOptions;
 };
 
 #endif //CODEGENERATOR_HPP
@@ -3,6 +3,9 @@
 // Primary include:
 #include "ActionsElement.hpp"
 
+#include "Expression.hpp"
+#include "../Generator.hpp"
+
 ActionsElement::ActionsElement(const std::shared_ptr<Token>& pTok)
 : Element(pTok),
   m_params(),
@@ -23,10 +26,14 @@ void ActionsElement::generateCode()
   getCppTypeInfo()->hppStatements.push_back("{");
   getCppTypeInfo()->hppStatements.push_back("public:");
   //Generate includes in cpp.
-  getCppTypeInfo()->cppIncludes.push_back("//Primary include:");
-  getCppTypeInfo()->cppIncludes.push_back("#include \"" + typeName + ".hpp\"");
+  if(!Generator::isInlineActions())
+  {
+    getCppTypeInfo()->cppIncludes.push_back("//Primary include:");
+    getCppTypeInfo()->cppIncludes.push_back("#include \"" + typeName + ".hpp\"");
+  }
 
-  std::string lines;
+  std::vector<std::shared_ptr<Expression> > exprs;
+  std::vector<std::string> verbatimLines;
   for(std::shared_ptr<SubElement> pSe : getChildren()->children)
   {
     if("SubElementActionLine" != pSe->getTypeName()) continue;
@@ -47,35 +54,79 @@ void ActionsElement::generateCode()
         line.append(" ");
       line.append(Utils::getCppVarName(pTok));
     }
-    lines.append(spaces + spaces + line + ";\n");
+    auto pExpr = Expression::parse(pSeActionLine->getRpnTokens());
+    if(pExpr)
+      pExpr->simplify(this);
+    exprs.push_back(pExpr);
+    verbatimLines.push_back(line);
+  }
+  //Values several lines compute are computed once, but only if every line is understood.
+  std::string lines;
+  bool isNoThrow = true;
+  if(exprs.end() == std::find(exprs.begin(), exprs.end(), std::shared_ptr<Expression>()))
+  {
+    for(std::shared_ptr<Expression> pExpr : exprs)
+      isNoThrow = isNoThrow && pExpr->isNoThrow(this);
+    for(const std::string& decl : Expression::hoistCommonSubexpressions(exprs, "common"))
+      lines.append(spaces + spaces + decl + "\n");
   }
-   
+  else
+    isNoThrow = false;
+  for(size_t i = 0; i < exprs.size(); ++i)
+    lines.append(spaces + spaces + (exprs.at(i) ? exprs.at(i)->toCpp() : verbatimLines.at(i)) + ";\n");
+
   std::string params(getParamString());
 
-  getCppTypeInfo()->hppStatements.push_back(Utils::getTabSpace() + "static void doActions(" + params + ");\n");
-  getCppTypeInfo()->cppStatements.push_back(
-    "void " + getCppTypeInfo()->getTypeNameStr() + "::doActions(" + params + ")\n"
-    "{\n"
-    + spaces + "/* Execute actions within try-catch to minimize crashes */\n"
-    + spaces + "try\n"
-    + spaces + "{\n"
-    + lines
-    + spaces + "}\n"
-    + spaces + "catch(const std::exception& ex)\n"
-    + spaces + "{\n"
-    + spaces + spaces + "std::cerr << \"An error occurred in doActions(): \" << std::string(ex.what()) << std::endl;\n"
-    + spaces + "}\n"
-    + spaces + "catch(...)\n"
-    + spaces + "{\n"
-    + spaces + spaces + "std::cerr << \"An unknown error occurred in doActions()\" << std::endl;\n"
-    + spaces + "}\n"
-    "}\n\n");
+  if(Generator::isInlineActions())
+  {
+    //Defined in the class so the state table can inline it. Errors reach the catch in the state
+    //table's runState(), so only actions that cannot throw are declared noexcept.
+    std::string templateParams(getTemplateParamString());
+    if(isNoThrow)
+      getCppTypeInfo()->hppIncludes.push_back("#include \"Conversion.hpp\" //TEBNF_NOEXCEPT\n");
+    if(!templateParams.empty())
+      getCppTypeInfo()->hppStatements.push_back(spaces + "template<" + templateParams + ">\n");
+    getCppTypeInfo()->hppStatements.push_back(
+      spaces + "static void doActions(" + params + ")" + (isNoThrow ? " TEBNF_NOEXCEPT" : "") + "\n"
+      + spaces + "{\n"
+      + lines
+      + spaces + "}\n");
+  }
+  else
+  {
+    getCppTypeInfo()->hppStatements.push_back(spaces + "static void doActions(" + params + ");\n");
+    getCppTypeInfo()->cppStatements.push_back(
+      "void " + getCppTypeInfo()->getTypeNameStr() + "::doActions(" + params + ")\n"
+      "{\n"
+      + spaces + "/* Execute actions within try-catch to minimize crashes */\n"
+      + spaces + "try\n"
+      + spaces + "{\n"
+      + lines
+      + spaces + "}\n"
+      + spaces + "catch(const std::exception& ex)\n"
+      + spaces + "{\n"
+      + spaces + spaces + "std::cerr << \"An error occurred in doActions(): \" << std::string(ex.what()) << std::endl;\n"
+      + spaces + "}\n"
+      + spaces + "catch(...)\n"
+      + spaces + "{\n"
+      + spaces + spaces + "std::cerr << \"An unknown error occurred in doActions()\" << std::endl;\n"
+      + spaces + "}\n"
+      "}\n\n");
+  }
 
   //End class in hpp.
   getCppTypeInfo()->hppStatements.push_back("}; //end " + typeString + " " + typeName);
-  //Append includes in cpp for element classes accessed by this generated class.
+  //Append includes for element classes accessed by this generated class.
   getCppTypeInfo()->appendAccessedElementIncludes();
-  getCppTypeInfo()->cppIncludes.push_back("\n");
+  if(Generator::isInlineActions())
+  {
+    //The actions are defined in hpp, so it includes what they access.
+    for(const std::string& include : getCppTypeInfo()->cppIncludes)
+      getCppTypeInfo()->hppIncludes.push_back(include);
+    getCppTypeInfo()->cppIncludes.clear();
+  }
+  else
+    getCppTypeInfo()->cppIncludes.push_back("\n");
 }
 
 std::string ActionsElement::getParamString() const
@@ -84,11 +135,29 @@ std::string ActionsElement::getParamString() const
   for(std::shared_ptr<Token> pParam : m_params)
   {
     if(!params.empty()) params.append(", ");
-    params.append("const StaticVariable& " + pParam->text);
+    //Inline actions take each argument in its native type.
+    std::string typeName(Generator::isInlineActions() ? getParamTypeName(pParam) : "StaticVariable");
+    params.append("const " + typeName + "& " + pParam->text);
   }
   return params;
 }
 
+std::string ActionsElement::getTemplateParamString() const
+{
+  std::string templateParams;
+  for(std::shared_ptr<Token> pParam : m_params)
+  {
+    if(!templateParams.empty()) templateParams.append(", ");
+    templateParams.append("typename " + getParamTypeName(pParam));
+  }
+  return templateParams;
+}
+
+std::string ActionsElement::getParamTypeName(std::shared_ptr<Token> pParam) const
+{
+  return Utils::toUpperCopy(pParam->text) + "_T";
+}
+
 std::string ActionsElement::getActionsFunctionCall() const
 {
   std::string funcCall(Utils::getCppVarName(getCppTypeInfo()) + "::doActions(");
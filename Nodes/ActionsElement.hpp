@@ -24,9 +24,15 @@ public:
   void generateCode();
   void addParam(std::shared_ptr<Token> pParamTok) { m_params.push_back(pParamTok); }
   void addArg(std::shared_ptr<Token> pParamTok) { m_args.push_back(pParamTok); }
+  const std::vector<std::shared_ptr<Token> >& getArgs() const { return m_args; }
+  /** @return the parameters of doActions(), StaticVariables, or template parameters when actions are inline. */
   std::string getParamString() const;
+  /** @return the template parameters of inline doActions(), one per parameter. */
+  std::string getTemplateParamString() const;
   std::string getActionsFunctionCall() const;
 private:
+  std::string getParamTypeName(std::shared_ptr<Token> pParam) const;
+
   std::vector<std::shared_ptr<Token> > m_params;
   std::vector<std::shared_ptr<Token> > m_args;
 };
@@ -97,6 +97,19 @@ bool CppTypeInfo::isStaticVariable() const
   return this && pCppTypeNode && pCppTypeNode->getToken()->isStaticVariable();
 }
 
+bool CppTypeInfo::isByteField() const
+{
+  //Typed byte vectors (e.g. BYTE{,}) are borrowed from the input buffer.
+  if(!isVector() || isLiteral() || !pCppTypeNode ||
+     ("int8_t" != typeStr && "uint8_t" != typeStr))
+    return false;
+  if(pCppTypeNode->getToken()->isSymbolTyped())
+    return true;
+  auto& children = pCppTypeNode->getChildren()->children;
+  return children.end() != std::find_if(children.begin(), children.end(),
+    [](std::shared_ptr<SubElement> pChild)->bool { return pChild->getToken()->isSymbolTyped(); });
+}
+
 std::string CppTypeInfo::getSizeStr()
 {
   std::stringstream szStrm;
@@ -92,6 +92,8 @@ struct CppTypeInfo
   size_t diffBytes;
   size_t resolvedSizeBits;
   std::shared_ptr<TypeRange> pTypeRange;
+  std::string checksumStr; //Checksum function, e.g. crc32c, if this is a checksum field.
+  std::shared_ptr<TypeRange> pChecksumRange; //First and last fields a checksum covers.
   std::vector<std::string> cppIncludes;
   std::vector<std::string> cppStatements;
   std::vector<std::string> hppIncludes;
@@ -114,6 +116,8 @@ struct CppTypeInfo
     diffBytes(0),
     resolvedSizeBits(0),
     pTypeRange(),
+    checksumStr(),
+    pChecksumRange(),
     cppIncludes(),
     cppStatements(),
     hppIncludes(),
@@ -127,7 +131,9 @@ struct CppTypeInfo
   bool isVector() const { return this && !isBitset() && !isString() && pTypeRange && pTypeRange->vectorType != TYPE_VEC_UNKNOWN; }
   bool isLiteral() const { return this && isLiteralVal; }
   bool isStaticVariable() const;
+  bool isByteField() const;
   bool isType() const { return this && isTypeAssignment; }
+  bool isChecksum() const { return this && !checksumStr.empty(); }
 
   std::string getSizeStr();
 
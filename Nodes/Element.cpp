@@ -8,6 +8,7 @@
 //Local includes:
 #include "Elements.hpp"
 #include "TypeUtils.hpp"
+#include "../Generator.hpp"
 #include "../Utils/Optional.hpp"
 #include "../Token.hpp"
 #include "../Utils/Utils.hpp"
@@ -170,6 +171,7 @@ Types::ElementType Types::getElementType(
            "MYSQL" == pTok->text ? ELEMENT_TYPE_IO_OUTPUT_MYSQL :
            "TCP_IP" == pTok->text ? ELEMENT_TYPE_IO_OUTPUT_TCP_IP :
            "UDP_IP" == pTok->text ? ELEMENT_TYPE_IO_OUTPUT_UDP_IP :
+           "COLUMNS" == pTok->text ? ELEMENT_TYPE_IO_OUTPUT_COLUMNS :
            ELEMENT_TYPE_NONE;
   }
   return ELEMENT_TYPE_NONE;
@@ -353,6 +355,31 @@ void Element::logUnresolved()
   logUnresolvedDescendants(*this);
 }
 
+//static
+std::string Element::generateInstanceAccessors(const std::string& typeName)
+{
+  std::string spc = Utils::getTabSpace();
+  //The pointer is constant initialized, so get() is a plain load with no lock or guard.
+  if(Generator::isSharded())
+  {
+    //Each shard's worker thread points instance() at the shard's own copy.
+    return std::string(
+      spc + "/** @return the instance of the shard whose thread calls. */\n"
+      + spc + "static " + typeName + "* get() { return instance(); }\n"
+      + spc + "/** Creates the instance of a shard once, when one of its state tables is constructed. */\n"
+      + spc + "static " + typeName + "* create(size_t shard) { return instance() = shards().get(shard, []() { return new " + typeName + "(); }); }\n"
+      + spc + "static " + typeName + "*& instance() { static TEBNF_THREAD_LOCAL " + typeName + "* s_pInstance = nullptr; return s_pInstance; }\n"
+      + spc + "/** Every shard's instance. */\n"
+      + spc + "static ShardInstances<" + typeName + ">& shards() { static ShardInstances<" + typeName + "> s_shards; return s_shards; }\n");
+  }
+  return std::string(
+    spc + "/** @return the instance created by the state table. */\n"
+    + spc + "static " + typeName + "* get() { return instance(); }\n"
+    + spc + "/** Creates the instance once, when a state table is constructed. */\n"
+    + spc + "static void create() { static " + typeName + " s_instance; instance() = &s_instance; }\n"
+    + spc + "static " + typeName + "*& instance() { static " + typeName + "* s_pInstance = nullptr; return s_pInstance; }\n");
+}
+
 void SubElementActionLine::setIsUsedInStateTable(bool isUsedInStateTable)
 {
   for(std::shared_ptr<Token> pTok : m_rpnTokens)
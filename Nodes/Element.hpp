@@ -46,7 +46,8 @@ namespace Types
     ELEMENT_TYPE_IO_INPUT_TCP_IP,
     ELEMENT_TYPE_IO_OUTPUT_TCP_IP,
     ELEMENT_TYPE_IO_INPUT_UDP_IP,
-    ELEMENT_TYPE_IO_OUTPUT_UDP_IP
+    ELEMENT_TYPE_IO_OUTPUT_UDP_IP,
+    ELEMENT_TYPE_IO_OUTPUT_COLUMNS
   };
 
   Types::ElementType getElementType(
@@ -310,6 +311,8 @@ public:
   void resolve();
   void logUnresolved();
   virtual void generateCode() {}
+  /** @return the generated static get() and create() of an element class. */
+  static std::string generateInstanceAccessors(const std::string& typeName);
   virtual std::string getTypeName() const { return "Element"; }
   virtual bool isElement() { return true; }
   void setName(const std::string& name) { m_name = name; }
@@ -0,0 +1,435 @@
+/**
+ * @see Expression.hpp
+ */
+
+//Primary include:
+#include "Expression.hpp"
+
+//Project includes:
+#include "Elements.hpp"
+
+//System includes:
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+namespace
+{
+  const size_t ASSIGNMENT_PRECEDENCE = 2;
+  const size_t PREFIX_PRECEDENCE = 15;
+  const size_t POSTFIX_PRECEDENCE = 16;
+  const size_t OPERAND_PRECEDENCE = 17;
+
+  //@return how tightly a binary operator binds, as in C++, or 0 if op is not one.
+  size_t getBinaryPrecedence(const std::string& op)
+  {
+    if("*" == op || "/" == op || "%" == op) return 13;
+    if("+" == op || "-" == op) return 12;
+    if("<<" == op || ">>" == op) return 11;
+    if("<" == op || "<=" == op || ">" == op || ">=" == op) return 10;
+    if("==" == op || "!=" == op) return 9;
+    if("&" == op) return 8;
+    if("^" == op) return 7;
+    if("|" == op) return 6;
+    if("&&" == op) return 5;
+    if("||" == op) return 4;
+    if("=" == op || "+=" == op || "-=" == op || "*=" == op || "/=" == op || "%=" == op ||
+       "<<=" == op || ">>=" == op || "&=" == op || "^=" == op || "|=" == op)
+      return ASSIGNMENT_PRECEDENCE;
+    return 0;
+  }
+
+  bool isPrefixOperator(const std::string& op)
+  {
+    return "-" == op || "+" == op || "!" == op || "~" == op || "++" == op || "--" == op;
+  }
+
+  //@return true if text is punctuation rather than an operand.
+  bool isPunctuation(const std::string& text)
+  {
+    return getBinaryPrecedence(text) > 0 || isPrefixOperator(text) ||
+      "(" == text || ")" == text || "[" == text || "]" == text ||
+      "{" == text || "}" == text || "," == text || "." == text || ";" == text;
+  }
+
+  //Literals are folded only while the result cannot overflow.
+  const long long FOLD_LIMIT = 1LL << 31;
+
+  bool foldIntegers(const std::string& op, long long lhs, long long rhs, long long& rResult)
+  {
+    if(lhs <= -FOLD_LIMIT || lhs >= FOLD_LIMIT || rhs <= -FOLD_LIMIT || rhs >= FOLD_LIMIT)
+      return false;
+    if("+" == op) rResult = lhs + rhs;
+    else if("-" == op) rResult = lhs - rhs;
+    else if("*" == op) rResult = lhs * rhs;
+    else if("/" == op && 0 != rhs) rResult = lhs / rhs;
+    else if("%" == op && 0 != rhs) rResult = lhs % rhs;
+    else return false;
+    return true;
+  }
+
+  //@return the shift equivalent to multiplying or dividing by value, or -1 if value is not a power of two above 1.
+  int getShift(long long value)
+  {
+    if(value < 2 || 0 != (value & (value - 1)))
+      return -1;
+    int shift = 0;
+    while(value > 1)
+    {
+      value >>= 1;
+      ++shift;
+    }
+    return shift;
+  }
+}
+
+Expression::Expression(ExpressionKind kind, const std::string& text)
+: m_kind(kind),
+  m_text(text),
+  m_pToken(),
+  m_pLhs(),
+  m_pRhs()
+{
+}
+
+std::shared_ptr<Expression> Expression::parse(const std::vector<std::shared_ptr<Token> >& tokens)
+{
+  size_t pos = 0;
+  auto pExpr = parseExpression(tokens, pos, 0);
+  return pExpr && tokens.size() == pos ? pExpr : std::shared_ptr<Expression>();
+}
+
+std::shared_ptr<Expression> Expression::parseExpression(
+  const std::vector<std::shared_ptr<Token> >& tokens,
+  size_t& rPos,
+  size_t minPrecedence)
+{
+  auto pLhs = parseOperand(tokens, rPos);
+  while(pLhs && rPos < tokens.size())
+  {
+    const std::string& op = tokens.at(rPos)->text;
+    if("++" == op || "--" == op)
+    {
+      std::shared_ptr<Expression> pPostfix(new Expression(EXPR_POSTFIX, op));
+      pPostfix->m_pLhs = pLhs;
+      pLhs = pPostfix;
+      ++rPos;
+      continue;
+    }
+    if("[" == op)
+    {
+      ++rPos;
+      std::shared_ptr<Expression> pIndex(new Expression(EXPR_INDEX, op));
+      pIndex->m_pLhs = pLhs;
+      pIndex->m_pRhs = parseExpression(tokens, rPos, 0);
+      if(!pIndex->m_pRhs || rPos >= tokens.size() || "]" != tokens.at(rPos)->text)
+        return std::shared_ptr<Expression>();
+      pLhs = pIndex;
+      ++rPos;
+      continue;
+    }
+    size_t precedence = getBinaryPrecedence(op);
+    if(0 == precedence || precedence < minPrecedence)
+      break;
+    ++rPos;
+    std::shared_ptr<Expression> pBinary(new Expression(EXPR_BINARY, op));
+    pBinary->m_pLhs = pLhs;
+    //Assignments group right to left, everything else left to right.
+    pBinary->m_pRhs = parseExpression(tokens, rPos,
+      ASSIGNMENT_PRECEDENCE == precedence ? precedence : precedence + 1);
+    if(!pBinary->m_pRhs)
+      return std::shared_ptr<Expression>();
+    pLhs = pBinary;
+  }
+  return pLhs;
+}
+
+std::shared_ptr<Expression> Expression::parseOperand(
+  const std::vector<std::shared_ptr<Token> >& tokens,
+  size_t& rPos)
+{
+  if(rPos >= tokens.size())
+    return std::shared_ptr<Expression>();
+  auto pTok = tokens.at(rPos++);
+  if("(" == pTok->text)
+  {
+    auto pExpr = parseExpression(tokens, rPos, 0);
+    if(!pExpr || rPos >= tokens.size() || ")" != tokens.at(rPos)->text)
+      return std::shared_ptr<Expression>();
+    ++rPos;
+    return pExpr;
+  }
+  if(isPrefixOperator(pTok->text))
+  {
+    std::shared_ptr<Expression> pPrefix(new Expression(EXPR_PREFIX, pTok->text));
+    pPrefix->m_pLhs = parseExpression(tokens, rPos, PREFIX_PRECEDENCE);
+    return pPrefix->m_pLhs ? pPrefix : std::shared_ptr<Expression>();
+  }
+  if(isPunctuation(pTok->text))
+    return std::shared_ptr<Expression>();
+  std::shared_ptr<Expression> pOperand(new Expression(EXPR_OPERAND, Utils::getCppVarName(pTok)));
+  pOperand->m_pToken = pTok;
+  return pOperand;
+}
+
+void Expression::simplify(Element* pScope)
+{
+  if(m_pLhs) m_pLhs->simplify(pScope);
+  if(m_pRhs) m_pRhs->simplify(pScope);
+  long long lhs = 0, rhs = 0, result = 0;
+  if(EXPR_BINARY == m_kind && m_pLhs->getIntegerValue(lhs) && m_pRhs->getIntegerValue(rhs) &&
+     foldIntegers(m_text, lhs, rhs, result))
+  {
+    m_kind = EXPR_OPERAND;
+    m_text = std::to_string(result);
+    m_pToken.reset();
+    m_pLhs.reset();
+    m_pRhs.reset();
+  }
+  else if(EXPR_PREFIX == m_kind && "-" == m_text && m_pLhs->getIntegerValue(lhs) && lhs >= 0)
+  {
+    m_kind = EXPR_OPERAND;
+    m_text = std::to_string(-lhs);
+    m_pLhs.reset();
+  }
+  else if(EXPR_BINARY == m_kind && m_pRhs->getIntegerValue(rhs) && getShift(rhs) > 0 &&
+          m_pLhs->isUnsignedOperand(pScope))
+  {
+    //Shifts and masks match multiplication, division and modulo only for unsigned values.
+    std::string op(m_text);
+    bool isAssignment = ASSIGNMENT_PRECEDENCE == getBinaryPrecedence(op);
+    std::string baseOp(isAssignment ? op.substr(0, op.size() - 1) : op);
+    std::string reducedOp = "*" == baseOp ? "<<" : "/" == baseOp ? ">>" : "%" == baseOp ? "&" : "";
+    if(!reducedOp.empty())
+    {
+      m_text = reducedOp + (isAssignment ? "=" : "");
+      m_pRhs.reset(new Expression(EXPR_OPERAND,
+        std::to_string("&" == reducedOp ? rhs - 1 : static_cast<long long>(getShift(rhs)))));
+    }
+  }
+}
+
+bool Expression::isUnsignedOperand(Element* pScope) const
+{
+  if(EXPR_OPERAND != m_kind || !m_pToken)
+    return false;
+  auto pAccessedTok = m_pToken->pAccessedElementToken;
+  if(m_pToken->isStaticVariable())
+  {
+    auto pGrammar = pAccessedTok ?
+      std::dynamic_pointer_cast<GrammarElement>(Elements::findElement(pAccessedTok->text)).get() :
+      dynamic_cast<GrammarElement*>(pScope);
+    return pGrammar && "uint64_t" == pGrammar->getStaticVariableType(m_pToken->text);
+  }
+  std::shared_ptr<SubElement> pField = pAccessedTok ?
+    Elements::findSubElement(m_pToken) :
+    pScope ? pScope->getChildren()->findChild(m_pToken->text) : std::shared_ptr<SubElement>();
+  auto pInfo = pField ? pField->getCppTypeInfo() : nullptr;
+  if(!pInfo || pInfo->isNumStr || pInfo->isVector() || pInfo->isString() || pInfo->isBitset() ||
+     (pInfo->pTypeRange && pInfo->pTypeRange->getSize() > 0) || pField->getChildren()->children.size() > 1)
+    return false;
+  return 0 == pInfo->typeStr.find("uint");
+}
+
+bool Expression::isNoThrow(Element* pScope) const
+{
+  switch(m_kind)
+  {
+  case EXPR_OPERAND:
+    {
+      long long value = 0;
+      if(!m_pToken)
+        return getIntegerValue(value);
+      if(m_pToken->isStaticVariable())
+      {
+        auto pAccessedTok = m_pToken->pAccessedElementToken;
+        auto pGrammar = pAccessedTok ?
+          std::dynamic_pointer_cast<GrammarElement>(Elements::findElement(pAccessedTok->text)).get() :
+          dynamic_cast<GrammarElement*>(pScope);
+        return pGrammar && !pGrammar->getStaticVariableType(m_pToken->text).empty();
+      }
+      //Numbers and characters are not always typed as literals.
+      const std::string& text = m_pToken->text;
+      return m_pToken->isLiteralNumber() ||
+        (!text.empty() && ('\'' == text[0] || std::isdigit(static_cast<unsigned char>(text[0]))));
+    }
+  case EXPR_PREFIX:
+  case EXPR_POSTFIX:
+    return m_pLhs->isNoThrow(pScope);
+  case EXPR_BINARY:
+    return m_pLhs->isNoThrow(pScope) && m_pRhs->isNoThrow(pScope);
+  case EXPR_INDEX:
+    return false;
+  };
+  return false;
+}
+
+std::vector<std::string> Expression::hoistCommonSubexpressions(
+  std::vector<std::shared_ptr<Expression> >& rLines,
+  const std::string& namePrefix)
+{
+  std::vector<std::string> declarations;
+  //Only values no line changes can be computed once, before the lines.
+  std::vector<std::string> writtenNames;
+  for(std::shared_ptr<Expression> pLine : rLines)
+    pLine->collectWrittenNames(writtenNames);
+  if(writtenNames.end() != std::find(writtenNames.begin(), writtenNames.end(), std::string()))
+    return declarations;
+  while(true)
+  {
+    std::map<std::string, size_t> counts;
+    for(std::shared_ptr<Expression> pLine : rLines)
+    {
+      std::vector<const Expression*> computations;
+      pLine->collectComputations(computations);
+      for(const Expression* pComputation : computations)
+      {
+        std::vector<std::string> operandNames;
+        pComputation->collectOperandNames(operandNames);
+        bool isUnchanged = operandNames.end() == std::find_first_of(
+          operandNames.begin(), operandNames.end(), writtenNames.begin(), writtenNames.end());
+        if(isUnchanged)
+          counts[pComputation->toCpp()]++;
+      }
+    }
+    //The longest repeated computation saves the most, and covers the ones inside it.
+    std::string repeated;
+    for(auto it = counts.begin(); it != counts.end(); ++it)
+    {
+      if(it->second > 1 && it->first.size() > repeated.size())
+        repeated = it->first;
+    }
+    if(repeated.empty())
+      break;
+    std::string name(namePrefix + std::to_string(declarations.size()));
+    declarations.push_back("const auto " + name + " = " + repeated + ";");
+    for(std::shared_ptr<Expression> pLine : rLines)
+      pLine->replaceComputation(repeated, name);
+  }
+  return declarations;
+}
+
+std::string Expression::toCpp() const
+{
+  auto wrap = [](const std::shared_ptr<Expression>& pExpr, size_t minPrecedence)->std::string
+  {
+    std::string cpp(pExpr->toCpp());
+    return pExpr->getPrecedence() < minPrecedence ? "(" + cpp + ")" : cpp;
+  };
+  switch(m_kind)
+  {
+  case EXPR_OPERAND:
+    return m_text;
+  case EXPR_PREFIX:
+  {
+    //Keep "- -x" from reading as a decrement.
+    std::string operand(wrap(m_pLhs, PREFIX_PRECEDENCE));
+    bool isSigned = !operand.empty() && ('-' == operand[0] || '+' == operand[0]);
+    return m_text + (isSigned ? "(" + operand + ")" : operand);
+  }
+  case EXPR_POSTFIX:
+    return wrap(m_pLhs, POSTFIX_PRECEDENCE) + m_text;
+  case EXPR_INDEX:
+    return wrap(m_pLhs, POSTFIX_PRECEDENCE) + "[" + m_pRhs->toCpp() + "]";
+  case EXPR_BINARY:
+  {
+    size_t precedence = getPrecedence();
+    bool isAssignment = ASSIGNMENT_PRECEDENCE == precedence;
+    return wrap(m_pLhs, isAssignment ? precedence + 1 : precedence) + " " + m_text + " " +
+      wrap(m_pRhs, isAssignment ? precedence : precedence + 1);
+  }
+  };
+  return m_text;
+}
+
+size_t Expression::getPrecedence() const
+{
+  switch(m_kind)
+  {
+  case EXPR_OPERAND: return !m_text.empty() && '-' == m_text[0] ? PREFIX_PRECEDENCE : OPERAND_PRECEDENCE;
+  case EXPR_PREFIX: return PREFIX_PRECEDENCE;
+  case EXPR_POSTFIX:
+  case EXPR_INDEX: return POSTFIX_PRECEDENCE;
+  case EXPR_BINARY: return getBinaryPrecedence(m_text);
+  };
+  return OPERAND_PRECEDENCE;
+}
+
+bool Expression::isPure() const
+{
+  switch(m_kind)
+  {
+  case EXPR_OPERAND: return true;
+  case EXPR_PREFIX: return "++" != m_text && "--" != m_text && m_pLhs->isPure();
+  case EXPR_POSTFIX: return false;
+  case EXPR_INDEX: return m_pLhs->isPure() && m_pRhs->isPure();
+  case EXPR_BINARY:
+    return ASSIGNMENT_PRECEDENCE != getBinaryPrecedence(m_text) && m_pLhs->isPure() && m_pRhs->isPure();
+  };
+  return false;
+}
+
+bool Expression::getIntegerValue(long long& rValue) const
+{
+  //Character literals are left as written.
+  if(EXPR_OPERAND != m_kind || m_text.empty() || !(std::isdigit(static_cast<unsigned char>(m_text[0])) ||
+     ('-' == m_text[0] && m_text.size() > 1)))
+    return false;
+  try
+  {
+    size_t length = 0;
+    rValue = std::stoll(m_text, &length, 0);
+    return m_text.size() == length;
+  }
+  catch(const std::exception&)
+  {
+    return false;
+  }
+}
+
+void Expression::collectWrittenNames(std::vector<std::string>& rNames) const
+{
+  bool isWrite = EXPR_POSTFIX == m_kind ||
+    (EXPR_PREFIX == m_kind && ("++" == m_text || "--" == m_text)) ||
+    (EXPR_BINARY == m_kind && ASSIGNMENT_PRECEDENCE == getBinaryPrecedence(m_text));
+  if(isWrite)
+  {
+    //Writing an item of a range changes the range; anything else is unknown, named by "".
+    const Expression* pTarget = m_pLhs.get();
+    while(EXPR_INDEX == pTarget->m_kind)
+      pTarget = pTarget->m_pLhs.get();
+    rNames.push_back(EXPR_OPERAND == pTarget->m_kind ? pTarget->m_text : std::string());
+  }
+  if(m_pLhs) m_pLhs->collectWrittenNames(rNames);
+  if(m_pRhs) m_pRhs->collectWrittenNames(rNames);
+}
+
+void Expression::collectOperandNames(std::vector<std::string>& rNames) const
+{
+  if(EXPR_OPERAND == m_kind)
+    rNames.push_back(m_text);
+  if(m_pLhs) m_pLhs->collectOperandNames(rNames);
+  if(m_pRhs) m_pRhs->collectOperandNames(rNames);
+}
+
+void Expression::collectComputations(std::vector<const Expression*>& rComputations) const
+{
+  if(EXPR_OPERAND != m_kind && isPure())
+    rComputations.push_back(this);
+  if(m_pLhs) m_pLhs->collectComputations(rComputations);
+  if(m_pRhs) m_pRhs->collectComputations(rComputations);
+}
+
+void Expression::replaceComputation(const std::string& cppText, const std::string& name)
+{
+  if(EXPR_OPERAND != m_kind && isPure() && cppText == toCpp())
+  {
+    m_kind = EXPR_OPERAND;
+    m_text = name;
+    m_pLhs.reset();
+    m_pRhs.reset();
+    return;
+  }
+  if(m_pLhs) m_pLhs->replaceComputation(cppText, name);
+  if(m_pRhs) m_pRhs->replaceComputation(cppText, name);
+}
@@ -0,0 +1,99 @@
+/**
+ *  TEBNF action line expression tree.
+ *
+ * @author  Jason Young
+ * @version 0.1
+ * @since   2026-10-19
+ */
+
+#ifndef EXPRESSION_HPP
+#define EXPRESSION_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Element;
+struct Token;
+
+class Expression
+{
+public:
+  enum ExpressionKind
+  {
+    EXPR_OPERAND,
+    EXPR_PREFIX,
+    EXPR_POSTFIX,
+    EXPR_BINARY,
+    EXPR_INDEX
+  };
+
+  /** Builds the tree of an action line from its tokens.
+   * @param[in] tokens - the tokens of the action line, in the order they were written.
+   * @return the tree, or null if the tokens are not an expression the tree can hold.
+   */
+  static std::shared_ptr<Expression> parse(const std::vector<std::shared_ptr<Token> >& tokens);
+
+  /** Folds operations on number literals and turns multiplication, division and modulo
+   *  of unsigned operands by a power of two into shifts and masks.
+   * @param[in] pScope - the element whose action line this is, used to look up operand types.
+   */
+  void simplify(Element* pScope);
+
+  /** Replaces subexpressions that several lines compute from values none of them change.
+   * @param[in,out] rLines - the trees of the lines, which then read the hoisted values.
+   * @param[in] namePrefix - prefix of the names of the hoisted values.
+   * @return a declaration for each hoisted value, to be placed before the lines.
+   */
+  static std::vector<std::string> hoistCommonSubexpressions(
+    std::vector<std::shared_ptr<Expression> >& rLines,
+    const std::string& namePrefix);
+
+  /** @return true if the expression only does arithmetic on number literals and natively typed $
+   *  variables, so it cannot throw. Fields, parameters, StaticVariables and indexing may.
+   * @param[in] pScope - the element whose action line this is, used to look up operand types.
+   */
+  bool isNoThrow(Element* pScope) const;
+
+  /** @return the expression as C++, with only the parentheses it needs. */
+  std::string toCpp() const;
+
+private:
+  Expression(ExpressionKind kind, const std::string& text);
+
+  static std::shared_ptr<Expression> parseExpression(
+    const std::vector<std::shared_ptr<Token> >& tokens,
+    size_t& rPos,
+    size_t minPrecedence);
+
+  static std::shared_ptr<Expression> parseOperand(
+    const std::vector<std::shared_ptr<Token> >& tokens,
+    size_t& rPos);
+
+  bool isUnsignedOperand(Element* pScope) const;
+
+  size_t getPrecedence() const;
+
+  bool isPure() const;
+
+  bool getIntegerValue(long long& rValue) const;
+
+  void collectWrittenNames(std::vector<std::string>& rNames) const;
+
+  void collectOperandNames(std::vector<std::string>& rNames) const;
+
+  void collectComputations(std::vector<const Expression*>& rComputations) const;
+
+  void replaceComputation(const std::string& cppText, const std::string& name);
+
+private:
+  ExpressionKind m_kind;
+  /** Operator, or the C++ name of an operand. */
+  std::string m_text;
+  /** Token of an operand, if it came from the action line. */
+  std::shared_ptr<Token> m_pToken;
+  std::shared_ptr<Expression> m_pLhs;
+  std::shared_ptr<Expression> m_pRhs;
+};
+
+#endif //EXPRESSION_HPP
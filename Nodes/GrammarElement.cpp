@@ -2,10 +2,23 @@
 //Primary include:
 #include "GrammarElement.hpp"
 
+#include "Elements.hpp"
+#include "Expression.hpp"
+#include "../Generator.hpp"
+
+//System includes:
+#include <cctype>
+
 GrammarElement::GrammarElement(const std::shared_ptr<Token>& pTok)
   : Element(pTok),
   m_initializerListSet(),
-  m_pLastTerminalSubElement()
+  m_pLastTerminalSubElement(),
+  m_isFixedLayout(false),
+  m_isMatchOnly(false),
+  m_iovScratchSize(0),
+  m_lazyFields(),
+  m_checksums(),
+  m_staticVarTypes()
 {
 }
 
@@ -23,7 +36,6 @@ void GrammarElement::generateCode()
   //Generate includes in cpp.
   getCppTypeInfo()->cppIncludes.push_back("//Primary include:");
   getCppTypeInfo()->cppIncludes.push_back("#include \"" + typeName + ".hpp\"");
-  getCppTypeInfo()->cppIncludes.push_back("#include \"Conversion.hpp\"");
   getCppTypeInfo()->cppIncludes.push_back("//System includes:");
 #if defined(_WIN32) || defined(_WIN64)
   getCppTypeInfo()->cppIncludes.push_back("#include <winsock2.h>   //hton, ntoh, sockets");
@@ -34,6 +46,8 @@ void GrammarElement::generateCode()
   //Generate constructor and initializer list in cpp.
   getCppTypeInfo()->cppStatements.push_back("\n" + typeName + "::" + typeName + "()");
   getCppTypeInfo()->cppStatements.push_back(":");
+  inferStaticVariableTypes();
+  findCounterVariables();
   //Generate member variable declarations and initializer lists.
   std::for_each(getChildren()->children.begin(), getChildren()->children.end(),
     [&](std::shared_ptr<SubElement> pChild)
@@ -41,20 +55,38 @@ void GrammarElement::generateCode()
   if(!getChildren()->children.empty())
     getCppTypeInfo()->cppStatements.back().append(",\n");
   getCppTypeInfo()->cppStatements.push_back(spaces + "m_data(),");
-  getCppTypeInfo()->cppStatements.push_back(spaces + "m_offset(0)");
+  getCppTypeInfo()->cppStatements.push_back(spaces + "m_offset(0),");
+  getCppTypeInfo()->cppStatements.push_back(spaces + "m_field(0),");
+  getCppTypeInfo()->cppStatements.push_back(spaces + "m_needed(0)");
+  m_isFixedLayout = checkFixedLayout();
+  findChecksumFields();
+  findLazyFields();
+  //Fixed layouts know where checksummed bytes are; others note it while decoding.
+  for(auto it = m_checksums.begin(); !m_isFixedLayout && it != m_checksums.end(); ++it)
+  {
+    getCppTypeInfo()->cppStatements.back().append(",");
+    getCppTypeInfo()->cppStatements.push_back(spaces + "m_" + it->first + "Begin(0),");
+    getCppTypeInfo()->cppStatements.push_back(spaces + "m_" + it->first + "End(0)");
+  }
   //Generate body of constructor in cpp.
   getCppTypeInfo()->cppStatements.push_back("{\n");
   getCppTypeInfo()->cppStatements.push_back("}\n\n");
+  //Generate the wire layout when every field has a static size.
+  if(m_isFixedLayout)
+    generateFixedLayout();
   //Generate remainder of code after declarations.
   std::for_each(getChildren()->children.begin(), getChildren()->children.end(),
     [&](std::shared_ptr<SubElement> pChild)
   { generateCode(pChild); });
+  //Generate the skip used for fields nothing reads.
+  generateLazyFieldFunctions();
   //Generate includes in hpp.
+  getCppTypeInfo()->hppIncludes.push_back("#include \"Conversion.hpp\"");
   getCppTypeInfo()->hppIncludes.push_back("//System includes:");
+  getCppTypeInfo()->hppIncludes.push_back("#include <array>        //std::array");
   getCppTypeInfo()->hppIncludes.push_back("#include <bitset>       //std::bitset");
   getCppTypeInfo()->hppIncludes.push_back("#include <cstdint>      //integral type sizes");
   getCppTypeInfo()->hppIncludes.push_back("#include <memory>       //std::shared_ptr, std::make_shared");
-  getCppTypeInfo()->hppIncludes.push_back("#include <mutex>        //std::mutex");
   getCppTypeInfo()->hppIncludes.push_back("#include <string>       //std::string");
   getCppTypeInfo()->hppIncludes.push_back("#include <vector>       //std::vector");
   //Declare constructor in hpp.
@@ -62,8 +94,27 @@ void GrammarElement::generateCode()
     Utils::getTabSpace() + getCppTypeInfo()->typeNameStr + "();");
   //Generate marshal/unmarshal function for this element.
   generateMarshalUnmarshalFunction();
+  //Generate the presized marshal used by state table outputs.
+  if(canMarshalInto())
+    generateMarshalIntoFunction();
+  if(canMarshalIov())
+    generateMarshalIovFunction();
+  //Generate the validation used by state tables that never read the fields.
+  if(canMatch())
+    generateMatchFunction();
+  //Generate materialize() for records that must outlive the input buffer.
+  generateMaterializeFunction();
   //Generate the actions function called whenever data is unmarshaled.
   generateActionsFunction();
+  //Generate the merge of every shard's $ variables.
+  if(Generator::isSharded())
+    generateMergeShardsFunction();
+  //Generate the batch decoder into per-field columns.
+  if(m_isFixedLayout)
+  {
+    generateDecodeAllFunction();
+    generateColumnFunctions();
+  }
   //Generate getResolvedSize().
   auto pSizeTok = getGrammarSize();
   if(pSizeTok)
@@ -84,25 +135,751 @@ void GrammarElement::generateCode()
     getCppTypeInfo()->hppStatements.push_back(
       Utils::getTabSpace() + "size_t getResolvedSize() { return " + bytesSize.str() + "; }");
   }
-  //Static get()
-  getCppTypeInfo()->hppStatements.push_back(
-    spaces + "static std::shared_ptr<" + getCppTypeInfo()->typeNameStr + "> get()\n"
-    + spaces + "{\n"
-    + spaces + spaces + "std::lock_guard<std::mutex> lock(m_mutex);\n"
-    + spaces + spaces + "static auto pInstance = std::make_shared<" + getCppTypeInfo()->typeNameStr + ">();\n"
-    + spaces + spaces + "return pInstance;\n"
-    + spaces + "}\n");
+  //Static get() and create()
+  getCppTypeInfo()->hppStatements.push_back(generateInstanceAccessors(getCppTypeInfo()->typeNameStr));
   //Utility functions.
   getCppTypeInfo()->hppStatements.push_back("private:\n");
-  getCppTypeInfo()->hppStatements.push_back(spaces + "std::vector<uint8_t> m_data;");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "DataView m_data; //Borrowed from the input element");
   getCppTypeInfo()->hppStatements.push_back(spaces + "size_t m_offset;");
-  getCppTypeInfo()->hppStatements.push_back(spaces + "std::mutex m_mutex;");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "size_t m_field; //Next field to decode when a record spans reads");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "size_t m_needed;");
+  if(m_iovScratchSize > 0)
+  {
+    std::stringstream scratch;
+    scratch << spaces << "std::array<uint8_t, " << m_iovScratchSize << "> m_iovScratch; //Small fields encoded by marshalIov()";
+    getCppTypeInfo()->hppStatements.push_back(scratch.str());
+  }
+  for(auto it = m_checksums.begin(); !m_isFixedLayout && it != m_checksums.end(); ++it)
+  {
+    getCppTypeInfo()->hppStatements.push_back(spaces + "size_t m_" + it->first + "Begin; //Bytes " + it->first + " covers, set by unmarshal");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "size_t m_" + it->first + "End;");
+  }
   //End class in hpp.
   getCppTypeInfo()->hppStatements.push_back("}; //end " + typeString + " " + typeName);
   //Append includes in cpp for element classes accessed by this generated class.
   getCppTypeInfo()->appendAccessedElementIncludes();
 }
 
+namespace
+{
+  //@return true if the field always takes the same number of bytes.
+  bool hasStaticSize(std::shared_ptr<CppTypeInfo> pInfo)
+  {
+    if(!pInfo || 0 == pInfo->resolvedSizeBytes || pInfo->diffBytes > 0 ||
+       pInfo->isBitset() || pInfo->pTypeSizeCastSubElement)
+      return false;
+    if(pInfo->isVector())
+    {
+      //Only byte vectors sized by a literal, e.g. BYTE{4} or a literal list.
+      auto pRange = pInfo->pTypeRange;
+      bool isLiteralBound = pRange->pMaxToken && !pRange->pMaxToken->pNode &&
+        (pRange->pMaxToken->isLiteral() || std::to_string(pRange->maxValue) == pRange->pMaxToken->text) &&
+        (TYPE_VEC_BOUNDED == pRange->vectorType ||
+         TYPE_VEC_MIN_UNBOUNDED == pRange->vectorType ||
+         (TYPE_VEC_MINMAX_BOUNDED == pRange->vectorType && pRange->minValue == pRange->maxValue));
+      if(!isLiteralBound || ("int8_t" != pInfo->typeStr && "uint8_t" != pInfo->typeStr))
+        return false;
+    }
+    return true;
+  }
+
+  //@return the most items a range field holds, or 0 if that is only known at run time.
+  size_t getStaticCapacity(std::shared_ptr<CppTypeInfo> pInfo)
+  {
+    auto pRange = pInfo ? pInfo->pTypeRange : nullptr;
+    //A number like the 5 in INT_16{2,5} is not always typed as a literal.
+    if(!pRange || pRange->isVectorUnbounded() || !pRange->pMaxToken || pRange->pMaxToken->pNode ||
+       (!pRange->pMaxToken->isLiteral() && std::to_string(pRange->maxValue) != pRange->pMaxToken->text))
+      return 0;
+    return pRange->getSize();
+  }
+
+  //@return the field whose value is this range field's item count, or empty if there is none.
+  std::string getCountField(std::shared_ptr<CppTypeInfo> pInfo)
+  {
+    auto pRange = pInfo->isVector() ? pInfo->pTypeRange : nullptr;
+    if(!pRange || !pRange->pMaxToken || !pRange->pMaxToken->pNode || !pRange->pMaxToken->isSymbolGrammar())
+      return std::string();
+    return pRange->pMaxToken->pNode->getCppTypeInfo()->typeNameStr;
+  }
+
+  //Fields smaller than this are cheaper to copy than to send as their own slice.
+  const size_t IOV_MIN_SLICE_SIZE = 64;
+
+  //@return true if marshalIov() encodes the field into its scratch area.
+  bool isIovScratchField(std::shared_ptr<CppTypeInfo> pInfo)
+  {
+    bool isByteRange = pInfo->isString() ||
+      (pInfo->isVector() && ("int8_t" == pInfo->typeStr || "uint8_t" == pInfo->typeStr));
+    return hasStaticSize(pInfo) && (!isByteRange || pInfo->resolvedSizeBytes < IOV_MIN_SLICE_SIZE);
+  }
+
+  //@return true if the field's memory already holds its wire bytes, so marshalIov() can send it in place.
+  bool isIovInPlaceField(std::shared_ptr<CppTypeInfo> pInfo)
+  {
+    return !pInfo->isNumStr && !isIovScratchField(pInfo) && (pInfo->isString() ||
+      (pInfo->isVector() && ("int8_t" == pInfo->typeStr || "uint8_t" == pInfo->typeStr)));
+  }
+
+  //Kinds of value a static variable is combined with; number literals fit any numeric kind.
+  enum ValueKind
+  {
+    VALUE_KIND_LITERAL = 1,
+    VALUE_KIND_UINT = 2,
+    VALUE_KIND_INT = 4,
+    VALUE_KIND_DOUBLE = 8,
+    VALUE_KIND_OTHER = 16
+  };
+
+  int getValueKind(const std::string& typeStr)
+  {
+    if("float" == typeStr || "double" == typeStr)
+      return VALUE_KIND_DOUBLE;
+    bool isIntegral = typeStr.size() > 2 && "_t" == typeStr.substr(typeStr.size() - 2);
+    if(isIntegral && 0 == typeStr.find("uint"))
+      return VALUE_KIND_UINT;
+    if(isIntegral && 0 == typeStr.find("int"))
+      return VALUE_KIND_INT;
+    return VALUE_KIND_OTHER;
+  }
+
+  //@return the kind of value pTok has in an action line of pScope.
+  int getValueKind(std::shared_ptr<Token> pTok, Element* pScope, bool isIndexed)
+  {
+    //The parser retypes literals in action lines, so they are told apart by their text.
+    const std::string& text = pTok->text;
+    if(pTok->isLiteralString() || (!text.empty() && '"' == text[0]))
+      return VALUE_KIND_OTHER;
+    if(pTok->isLiteral() || (!text.empty() && ('\'' == text[0] || std::isdigit(static_cast<unsigned char>(text[0])))))
+    {
+      bool isFloat = Token::LITERAL_FLT == pTok->type ||
+        ('\'' != text[0] && 0 != text.find("0x") && std::string::npos != text.find('.'));
+      return isFloat ? VALUE_KIND_DOUBLE : VALUE_KIND_LITERAL;
+    }
+    std::shared_ptr<CppTypeInfo> pInfo;
+    if(pTok->isSymbolTyped())
+      return TypeUtils::getCppTypeInfo(pTok, pInfo) ? getValueKind(pInfo->typeStr) : VALUE_KIND_OTHER;
+    auto pField = pTok->pAccessedElementToken ?
+      Elements::findSubElement(pTok) :
+      pScope->getChildren()->findChild(pTok->text);
+    pInfo = pField ? pField->getCppTypeInfo() : nullptr;
+    if(!pInfo || pField->getChildren()->children.size() > 1)
+      return VALUE_KIND_OTHER;
+    //Only an item of a range or string is a number.
+    bool isRange = pInfo->isVector() || pInfo->isString() || pInfo->isBitset() ||
+      (pInfo->pTypeRange && pInfo->pTypeRange->getSize() > 0);
+    return isRange == isIndexed ? getValueKind(pInfo->typeStr) : VALUE_KIND_OTHER;
+  }
+
+  //Adds the fields of grammarName that pNode reads to rFields.
+  void collectFieldUses(
+    Node* pNode,
+    const std::string& grammarName,
+    std::set<std::string>& rFields,
+    bool& rIsWholeUsed)
+  {
+    if(!pNode)
+      return;
+    auto useToken = [&](std::shared_ptr<Token> pTok)
+    {
+      if(pTok->pAccessedElementToken && grammarName == pTok->pAccessedElementToken->text)
+        rFields.insert(pTok->text);
+      else if(grammarName == pTok->text)
+        rIsWholeUsed = true;
+    };
+    if(pNode->isType("SubElementActionLine"))
+    {
+      for(std::shared_ptr<Token> pTok : reinterpret_cast<SubElementActionLine*>(pNode)->getRpnTokens())
+        useToken(pTok);
+      return;
+    }
+    if(pNode->isType("ActionsElement"))
+    {
+      for(std::shared_ptr<Token> pTok : reinterpret_cast<ActionsElement*>(pNode)->getArgs())
+        useToken(pTok);
+    }
+    else if(pNode->isElement())
+    {
+      if(grammarName == dynamic_cast<Element*>(pNode)->getName())
+        rIsWholeUsed = true;
+      return;
+    }
+    else
+    {
+      useToken(pNode->getToken());
+    }
+    for(std::shared_ptr<SubElement> pChild : pNode->getChildren()->children)
+      collectFieldUses(pChild.get(), grammarName, rFields, rIsWholeUsed);
+  }
+}
+
+namespace
+{
+  //@return false unless the literal's first byte on the wire is known here.
+  bool getLiteralFirstByte(std::shared_ptr<Token> pTok, size_t litSize, uint8_t& rByte)
+  {
+    const std::string& text = pTok->text;
+    if(Token::LITERAL_CHR == pTok->type || Token::LITERAL_STR == pTok->type)
+    {
+      //Escapes are left to the ordered attempts.
+      if(text.size() < 3 || '\\' == text[1])
+        return false;
+      rByte = static_cast<uint8_t>(text[1]);
+      return true;
+    }
+    if(!pTok->isLiteralNumber() || Token::LITERAL_FLT == pTok->type || 0 == litSize || litSize > 8)
+      return false;
+    try
+    {
+      //Numbers are marshaled in network byte order, most significant byte first.
+      unsigned long long value = std::stoull(text, nullptr, 0);
+      rByte = static_cast<uint8_t>(value >> (8 * (litSize - 1)));
+      return true;
+    }
+    catch(const std::exception&)
+    {
+      return false;
+    }
+  }
+}
+
+bool GrammarElement::getFirstBytes(std::set<uint8_t>& rFirstBytes)
+{
+  rFirstBytes.clear();
+  std::shared_ptr<SubElement> pFirstField;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(!pSe->getToken()->isStaticVariable())
+    {
+      pFirstField = pSe;
+      break;
+    }
+  }
+  if(!pFirstField || !pFirstField->getCppTypeInfo()->isLiteral() || !pFirstField->hasChildren())
+    return false;
+  //The first literal and the ones or'ed with it can start the record.
+  auto& rChildren = pFirstField->getChildren()->children;
+  for(size_t i = 0; i < rChildren.size(); i++)
+  {
+    auto pChild = rChildren.at(i);
+    if(i > 0 && !(pChild->getRelationToSibling() && Token::OPERATOR_OR == pChild->getRelationToSibling().get()))
+      break;
+    uint8_t firstByte = 0;
+    if(!pChild->getToken()->isLiteral() || !pChild->getCppTypeInfo() ||
+       !getLiteralFirstByte(pChild->getToken(), pChild->getCppTypeInfo()->resolvedSizeBytes, firstByte))
+      return false;
+    rFirstBytes.insert(firstByte);
+  }
+  return !rFirstBytes.empty();
+}
+
+void GrammarElement::findLazyFields()
+{
+  m_lazyFields.clear();
+  m_isMatchOnly = false;
+  std::string grammarName(getName());
+  std::set<std::string> usedFields;
+  bool isWholeUsed = false;
+  for(std::shared_ptr<Element> pElement : Elements::elements())
+  {
+    if(pElement.get() == this)
+      continue;
+    for(std::shared_ptr<SubElement> pSe : pElement->getChildren()->children)
+    {
+      if(pSe->isType("SubElementState"))
+      {
+        auto pRow = reinterpret_cast<SubElementState*>(pSe.get());
+        //Reading this grammar as input only unmarshals it.
+        if(pRow->getInputOrCondition().get() != this)
+          collectFieldUses(pRow->getInputOrCondition().get(), grammarName, usedFields, isWholeUsed);
+        collectFieldUses(pRow->getOutputOrAction().get(), grammarName, usedFields, isWholeUsed);
+      }
+      else
+      {
+        collectFieldUses(pSe.get(), grammarName, usedFields, isWholeUsed);
+      }
+    }
+  }
+  //Marshaling the whole grammar reads every field.
+  if(isWholeUsed)
+    return;
+  m_isMatchOnly = usedFields.empty();
+  //Fields read by this grammar's own variables or that size other fields.
+  for(std::shared_ptr<SubElement> pChild : getChildren()->children)
+  {
+    auto pActionLine = std::dynamic_pointer_cast<SubElementActionLine>(pChild);
+    if(pActionLine && pChild->getToken()->isStaticVariable())
+    {
+      m_isMatchOnly = false; //Actions run on every record unmarshaled.
+      for(std::shared_ptr<Token> pTok : pActionLine->getRpnTokens())
+        usedFields.insert(pTok->text);
+      continue;
+    }
+    auto pInfo = pChild->getCppTypeInfo();
+    if(pInfo && pInfo->pTypeSizeCastSubElement)
+      usedFields.insert(pInfo->pTypeSizeCastSubElement->getToken()->text);
+    if(pInfo && pInfo->pTypeRange)
+    {
+      if(pInfo->pTypeRange->pMinToken && pInfo->pTypeRange->pMinToken->pNode)
+        usedFields.insert(pInfo->pTypeRange->pMinToken->text);
+      if(pInfo->pTypeRange->pMaxToken && pInfo->pTypeRange->pMaxToken->pNode)
+        usedFields.insert(pInfo->pTypeRange->pMaxToken->text);
+    }
+  }
+  if(getGrammarSize())
+    usedFields.insert(getGrammarSize()->text);
+  //Reading a composite field reads each of its parts.
+  std::vector<std::string> pendingFields(usedFields.begin(), usedFields.end());
+  while(!pendingFields.empty())
+  {
+    auto pField = getChildren()->findChild(pendingFields.back());
+    pendingFields.pop_back();
+    if(!pField)
+      continue;
+    for(std::shared_ptr<SubElement> pPart : pField->getChildren()->children)
+    {
+      if(pPart->getToken()->isSymbolGrammar() && usedFields.insert(pPart->getToken()->text).second)
+        pendingFields.push_back(pPart->getToken()->text);
+    }
+  }
+  //Literals are still decoded so unmarshal can validate them.
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    auto pInfo = pSe->getCppTypeInfo();
+    if(pSe->getToken()->isStaticVariable() || !pInfo || pInfo->isLiteral() || pInfo->isChecksum() ||
+       !hasStaticSize(pInfo) || usedFields.count(pInfo->typeNameStr))
+      continue;
+    m_lazyFields.insert(pInfo->typeNameStr);
+  }
+}
+
+void GrammarElement::generateLazyFieldFunctions()
+{
+  if(m_lazyFields.empty())
+    return;
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->typeNameStr);
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** Step over a field no state or action reads, without decoding it. */\n" +
+    spaces + "bool skip(size_t& rDataOffset, size_t fieldSize);");
+  getCppTypeInfo()->cppStatements.push_back(
+    "bool " + typeName + "::skip(size_t& rDataOffset, size_t fieldSize)\n" +
+    "{\n" +
+    spaces + "rDataOffset += fieldSize;\n" +
+    spaces + (m_isFixedLayout ? "return true;\n" : "return rDataOffset <= m_data.size();\n") +
+    "}\n\n");
+}
+
+void GrammarElement::findChecksumFields()
+{
+  m_checksums.clear();
+  std::vector<std::string> fields;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    if(pInfo->isChecksum())
+    {
+      //The range names the first and last fields covered; an open end
+      //extends to the first field or to the field before the checksum.
+      ChecksumCoverage coverage;
+      coverage.func = pInfo->checksumStr;
+      auto pRange = pInfo->pChecksumRange;
+      std::shared_ptr<Token> pFirstTok(pRange ? pRange->pMinToken : nullptr);
+      std::shared_ptr<Token> pLastTok(pRange ? pRange->pMaxToken : nullptr);
+      if(pRange && TYPE_VEC_BOUNDED == pRange->vectorType)
+        pFirstTok = pLastTok;
+      coverage.firstField = pFirstTok ? Utils::getCppVarName(pFirstTok->text) :
+        fields.empty() ? std::string() : fields.front();
+      coverage.lastField = pLastTok ? Utils::getCppVarName(pLastTok->text) :
+        fields.empty() ? std::string() : fields.back();
+      auto firstIt = std::find(fields.begin(), fields.end(), coverage.firstField);
+      auto lastIt = std::find(fields.begin(), fields.end(), coverage.lastField);
+      if(fields.end() == firstIt || fields.end() == lastIt || firstIt > lastIt)
+        Utils::Logger::logErr(pSe->getToken(), "Checksum must cover fields that come before it, in order");
+      else
+        m_checksums[pInfo->typeNameStr] = coverage;
+    }
+    fields.push_back(pInfo->typeNameStr);
+  }
+}
+
+std::string GrammarElement::getChecksumCall(
+  const std::string& field,
+  const std::string& base,
+  const std::string& begin,
+  const std::string& end)
+{
+  return "Checksum::" + m_checksums[field].func + "(" + base + " + " + begin + ", " + end + " - " + begin + ")";
+}
+
+std::string GrammarElement::getLayoutChecksumCall(const std::string& field, const std::string& base)
+{
+  const ChecksumCoverage& rCoverage = m_checksums[field];
+  return getChecksumCall(field, base, "Layout::" + rCoverage.firstField + "Offset",
+    "Layout::" + rCoverage.lastField + "Offset + Layout::" + rCoverage.lastField + "Size");
+}
+
+bool GrammarElement::checkFixedLayout()
+{
+  if(getGrammarSize())
+    return false;
+  size_t fieldCount = 0;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    if(!hasStaticSize(pSe->getCppTypeInfo()))
+      return false;
+    //Fields composed of other fields are decoded through those fields.
+    for(std::shared_ptr<SubElement> pChild : pSe->getChildren()->children)
+    {
+      if(pChild->getToken()->isSymbolGrammar())
+        return false;
+    }
+    ++fieldCount;
+  }
+  return fieldCount > 0;
+}
+
+void GrammarElement::generateFixedLayout()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::stringstream layout, wire;
+  size_t offset = 0;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    std::string name(pInfo->typeNameStr);
+    layout << spaces << spaces << "static const size_t " << name << "Offset = " << offset << ";\n"
+           << spaces << spaces << "static const size_t " << name << "Size = " << pInfo->resolvedSizeBytes << ";\n";
+    if(pInfo->isNumStr || pInfo->isString())
+      wire << spaces << spaces << "char " << name << "[" << pInfo->resolvedSizeBytes << "];\n";
+    else if(pInfo->isVector())
+      wire << spaces << spaces << pInfo->typeStr << " " << name << "[" << pInfo->resolvedSizeBytes << "];\n";
+    else
+      wire << spaces << spaces << pInfo->typeStr << " " << name << ";\n";
+    offset += pInfo->resolvedSizeBytes;
+  }
+  std::stringstream totalSize;
+  totalSize << offset;
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** Byte offset and size of each field on the wire. */\n" +
+    spaces + "struct Layout\n" +
+    spaces + "{\n" +
+    layout.str() +
+    spaces + spaces + "static const size_t totalSize = " + totalSize.str() + ";\n" +
+    spaces + "};\n" +
+    "#pragma pack(push, 1)\n" +
+    spaces + "/** Packed view of a record as it appears on the wire, in network byte order. */\n" +
+    spaces + "struct Wire\n" +
+    spaces + "{\n" +
+    wire.str() +
+    spaces + "};\n" +
+    "#pragma pack(pop)\n" +
+    spaces + "static_assert(sizeof(Wire) == Layout::totalSize, \"Wire must match the grammar layout\");\n" +
+    spaces + "/** @return the last unmarshaled record in place; valid while the input buffer is. */\n" +
+    spaces + "const Wire* wire() const { return reinterpret_cast<const Wire*>(m_data.begin()); }\n");
+}
+
+void GrammarElement::generateDecodeAllFunction()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->getTypeNameStr());
+  std::string decls, resizes, loads;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    std::string name(pInfo->typeNameStr);
+    std::string row(spaces + spaces + spaces);
+    std::string src("pRecord + Layout::" + name + "Offset");
+    if(!pInfo->isNumStr && (pInfo->isVector() || pInfo->isString() || pInfo->isLiteral()))
+    {
+      //Multi-byte fields are kept as raw bytes, Layout::<field>Size per record.
+      decls += spaces + spaces + "std::vector<uint8_t> " + name + "; //Layout::" + name + "Size bytes per record\n";
+      resizes += spaces + "columns." + name + ".resize(columns.count * Layout::" + name + "Size);\n";
+      loads += row + "memcpy(&columns." + name + "[i * Layout::" + name + "Size], " + src + ", Layout::" + name + "Size);\n";
+      continue;
+    }
+    decls += spaces + spaces + "std::vector<decltype(" + typeName + "::" + name + ")> " + name + ";\n";
+    resizes += spaces + "columns." + name + ".resize(columns.count);\n";
+    if(pInfo->isNumStr)
+      loads += row + "Conversion::loadNumString(" + src + ", columns." + name + "[i], Layout::" + name + "Size);\n";
+    else
+      loads += row + "Conversion::load(" + src + ", columns." + name + "[i]);\n";
+  }
+  //Checksums are verified while each record is decoded.
+  std::string checks;
+  for(auto& rChecksum : m_checksums)
+  {
+    checks += (checks.empty() ? "" : " &&\n" + Utils::getTabSpace(1, 25)) +
+      "columns." + rChecksum.first + "[i] == " + getLayoutChecksumCall(rChecksum.first, "pRecord");
+  }
+  if(!checks.empty())
+  {
+    decls += spaces + spaces + "std::vector<uint8_t> valid; //1 where every checksum of the record matched\n";
+    resizes += spaces + "columns.valid.resize(columns.count);\n";
+    loads += spaces + spaces + spaces + "columns.valid[i] = " + checks + ";\n";
+  }
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** Fields of many records, one contiguous column per field. */\n" +
+    spaces + "struct Columns\n" +
+    spaces + "{\n" +
+    decls +
+    spaces + spaces + "size_t count = 0; //Records decoded\n" +
+    spaces + "};\n" +
+    spaces + "/**\n" +
+    spaces + " * Decodes every whole record of back-to-back data into columns, without actions.\n" +
+    spaces + " * Literal fields are copied, not checked. Work is split on record boundaries.\n" +
+    spaces + " */\n" +
+    spaces + "static Columns decodeAll(const DataView& data, unsigned threadCount = 1);\n");
+  getCppTypeInfo()->cppStatements.push_back(
+    typeName + "::Columns " + typeName + "::decodeAll(const DataView& data, unsigned threadCount)\n"
+    "{\n" +
+    spaces + "Columns columns;\n" +
+    spaces + "columns.count = data.size() / Layout::totalSize;\n" +
+    resizes +
+    spaces + "//Each range writes only its own rows, so ranges decode independently.\n" +
+    spaces + "auto decodeRange = [&](size_t first, size_t last)\n" +
+    spaces + "{\n" +
+    spaces + spaces + "for(size_t i = first; i < last; ++i)\n" +
+    spaces + spaces + "{\n" +
+    spaces + spaces + spaces + "const uint8_t* pRecord = data.begin() + i * Layout::totalSize;\n" +
+    loads +
+    spaces + spaces + "}\n" +
+    spaces + "};\n" +
+    spaces + "if(threadCount < 2 || columns.count < threadCount)\n" +
+    spaces + "{\n" +
+    spaces + spaces + "decodeRange(0, columns.count);\n" +
+    spaces + spaces + "return columns;\n" +
+    spaces + "}\n" +
+    spaces + "std::vector<std::thread> workers;\n" +
+    spaces + "size_t perThread = (columns.count + threadCount - 1) / threadCount;\n" +
+    spaces + "for(size_t first = 0; first < columns.count; first += perThread)\n" +
+    spaces + spaces + "workers.emplace_back(decodeRange, first, std::min(first + perThread, columns.count));\n" +
+    spaces + "for(std::thread& worker : workers)\n" +
+    spaces + spaces + "worker.join();\n" +
+    spaces + "return columns;\n" +
+    "}\n\n");
+  getCppTypeInfo()->cppIncludes.push_back("#include <algorithm>    //std::min");
+  getCppTypeInfo()->cppIncludes.push_back("#include <cstring>      //memcpy");
+  getCppTypeInfo()->cppIncludes.push_back("#include <thread>       //std::thread");
+}
+
+void GrammarElement::generateColumnFunctions()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->getTypeNameStr());
+  std::string schema, rows;
+  size_t column = 0;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    std::string name(pInfo->typeNameStr);
+    std::stringstream idx;
+    idx << column++;
+    if(!pInfo->isNumStr && (pInfo->isVector() || pInfo->isString() || pInfo->isLiteral()))
+    {
+      schema += spaces + spaces + "{ \"" + name + "\", Layout::" + name + "Size, 'b' },\n";
+      rows += spaces + "Conversion::appendColumn(rColumns[" + idx.str() + "], " + name + ".data(), Layout::" + name + "Size);\n";
+      continue;
+    }
+    const std::string& typeStr = pInfo->typeStr;
+    char type = std::string::npos != typeStr.find("float") || std::string::npos != typeStr.find("double") ? 'f' :
+                0 == typeStr.find("uint") || 0 == typeStr.find("unsigned") || "bool" == typeStr ? 'u' : 'i';
+    schema += spaces + spaces + "{ \"" + name + "\", sizeof(" + name + "), '" + type + "' },\n";
+    rows += spaces + "Conversion::appendColumn(rColumns[" + idx.str() + "], &" + name + ", sizeof(" + name + "));\n";
+  }
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** @return one entry per field, in the order appendRow() writes them. */\n" +
+    spaces + "static const std::vector<ColumnSchema>& columnSchema();\n" +
+    spaces + "/** Appends this record to one fixed-width column per field, for columnar outputs. */\n" +
+    spaces + "void appendRow(std::vector<std::vector<uint8_t>>& rColumns);\n");
+  getCppTypeInfo()->cppStatements.push_back(
+    "const std::vector<ColumnSchema>& " + typeName + "::columnSchema()\n"
+    "{\n" +
+    spaces + "static const std::vector<ColumnSchema> s_schema =\n" +
+    spaces + "{\n" +
+    schema +
+    spaces + "};\n" +
+    spaces + "return s_schema;\n" +
+    "}\n\n" +
+    "void " + typeName + "::appendRow(std::vector<std::vector<uint8_t>>& rColumns)\n"
+    "{\n" +
+    rows +
+    "}\n\n");
+}
+
+bool GrammarElement::canMarshalInto()
+{
+  size_t fieldCount = 0;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    //Bitsets, size casts and padded numbers still go through marshal().
+    auto pInfo = pSe->getCppTypeInfo();
+    if(!pInfo || pInfo->isBitset() || pInfo->diffBytes > 0 || pInfo->pTypeSizeCastSubElement)
+      return false;
+    for(std::shared_ptr<SubElement> pChild : pSe->getChildren()->children)
+    {
+      if(pChild->getToken()->isSymbolGrammar())
+        return false;
+    }
+    ++fieldCount;
+  }
+  return fieldCount > 0;
+}
+
+void GrammarElement::generateMarshalIntoFunction()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->getTypeNameStr());
+  std::string sizes, stores;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    std::string name(pInfo->typeNameStr);
+    std::string dst(m_isFixedLayout ? "pDst + Layout::" + name + "Offset" : "pDst");
+    std::string checksumEnds;
+    for(auto it = m_checksums.begin(); !m_isFixedLayout && it != m_checksums.end(); ++it)
+    {
+      if(name == it->second.firstField)
+        stores += spaces + "size_t " + it->first + "Begin = static_cast<size_t>(pDst - pRecord);\n";
+      if(name == it->second.lastField)
+        checksumEnds += spaces + "size_t " + it->first + "End = static_cast<size_t>(pDst - pRecord);\n";
+    }
+    //The covered fields are already stored, so the checksum is computed from them.
+    if(m_checksums.count(name))
+    {
+      stores += spaces + name + " = " + (m_isFixedLayout ? getLayoutChecksumCall(name, "pDst") :
+        getChecksumCall(name, "pRecord", name + "Begin", name + "End")) + ";\n";
+    }
+    std::stringstream store;
+    if(pInfo->isNumStr)
+      store << "Conversion::storeNumString(" << dst << ", " << name << ", " << pInfo->resolvedSizeBytes << ")";
+    else
+      store << "Conversion::store(" << dst << ", " << name << ")";
+    stores += spaces + (m_isFixedLayout ? store.str() : "pDst += " + store.str()) + ";\n" + checksumEnds;
+    if(m_isFixedLayout)
+      continue;
+    std::stringstream size;
+    if(pInfo->isNumStr)
+      size << pInfo->resolvedSizeBytes;
+    else
+      size << "Conversion::wireSize(" << name << ")";
+    sizes += (sizes.empty() ? "" : " +\n" + Utils::getTabSpace(1, 9)) + size.str();
+  }
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** @return the bytes marshalInto() writes for this record. */\n" +
+    spaces + "size_t wireSize();\n" +
+    spaces + "/** Writes the record to pDst, which holds at least wireSize() bytes. */\n" +
+    spaces + "void marshalInto(uint8_t* pDst);\n");
+  getCppTypeInfo()->cppStatements.push_back(
+    "size_t " + typeName + "::wireSize()\n"
+    "{\n" +
+    spaces + "return " + (m_isFixedLayout ? "Layout::totalSize" : sizes) + ";\n" +
+    "}\n\n" +
+    "void " + typeName + "::marshalInto(uint8_t* pDst)\n"
+    "{\n" +
+    (m_isFixedLayout || m_checksums.empty() ? "" : spaces + "const uint8_t* pRecord = pDst;\n") +
+    stores +
+    "}\n\n");
+}
+
+bool GrammarElement::canMarshalIov()
+{
+  //Checksums are computed over contiguous bytes, which marshalInto() provides.
+  if(!canMarshalInto() || !m_checksums.empty())
+    return false;
+  bool hasInPlaceField = false;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    if(isIovInPlaceField(pInfo))
+      hasInPlaceField = true;
+    else if(!isIovScratchField(pInfo))
+      return false;
+  }
+  return hasInPlaceField;
+}
+
+void GrammarElement::generateMarshalIovFunction()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->getTypeNameStr());
+  std::string body;
+  size_t sliceCount = 0;
+  bool isScratchRunOpen = false;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    std::string name(pInfo->typeNameStr);
+    if(isIovScratchField(pInfo))
+    {
+      //Neighbouring small fields share one slice of the scratch area.
+      if(!isScratchRunOpen && m_iovScratchSize > 0)
+        body += spaces + "pRun = pDst;\n";
+      isScratchRunOpen = true;
+      std::stringstream store;
+      if(pInfo->isNumStr)
+        store << "Conversion::storeNumString(pDst, " << name << ", " << pInfo->resolvedSizeBytes << ")";
+      else
+        store << "Conversion::store(pDst, " << name << ")";
+      body += spaces + "pDst += " + store.str() + ";\n";
+      m_iovScratchSize += pInfo->resolvedSizeBytes;
+      continue;
+    }
+    if(isScratchRunOpen)
+    {
+      body += spaces + "pSlices[count++] = IoSlice{ pRun, static_cast<size_t>(pDst - pRun) };\n";
+      isScratchRunOpen = false;
+      ++sliceCount;
+    }
+    body += spaces + "pSlices[count++] = IoSlice{ Conversion::wireBytes(" + name + "), Conversion::wireSize(" + name + ") };\n";
+    ++sliceCount;
+  }
+  if(isScratchRunOpen)
+  {
+    body += spaces + "pSlices[count++] = IoSlice{ pRun, static_cast<size_t>(pDst - pRun) };\n";
+    ++sliceCount;
+  }
+  std::stringstream maxSlices;
+  maxSlices << sliceCount;
+  std::string scratchDecls(m_iovScratchSize > 0 ?
+    spaces + "uint8_t* pDst = m_iovScratch.data();\n" + spaces + "uint8_t* pRun = pDst;\n" : "");
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** Most slices marshalIov() fills. */\n" +
+    spaces + "static const size_t iovMaxSlices = " + maxSlices.str() + ";\n" +
+    spaces + "/**\n" +
+    spaces + " * Describes the record's wire bytes without building them in one buffer:\n" +
+    spaces + " * small fields are encoded into a scratch area, large ones are sent in place.\n" +
+    spaces + " * The slices are valid until this record changes. @return the slices used.\n" +
+    spaces + " */\n" +
+    spaces + "size_t marshalIov(IoSlice* pSlices);\n");
+  getCppTypeInfo()->cppStatements.push_back(
+    "size_t " + typeName + "::marshalIov(IoSlice* pSlices)\n"
+    "{\n" +
+    spaces + "size_t count = 0;\n" +
+    scratchDecls +
+    body +
+    spaces + "return count;\n" +
+    "}\n\n");
+}
+
 void GrammarElement::generateMarshalUnmarshalFunction()
 {
   auto grammarIsMatchSubElements = getGrammarUnmarshalSubElements();
@@ -116,13 +893,30 @@ void GrammarElement::generateMarshalUnmarshalFunction()
     "{\n" +
     spaces + "if(!rData.empty()) rData.clear();\n" + spaces);
   std::string isMatchUnmarshalFunc(
-    "bool " + typeName + "::unmarshal(std::vector<uint8_t>& data)\n" +
-    "{\n" +
-    spaces + "get().reset(); // Reset to ensure a correct match to data\n" +
-    spaces + "m_data.resize(data.size());\n" +
-    spaces + "memcpy(&m_data[0], &data[0], data.size());\n" +
-    spaces + offsetName + " = 0;\n" +
-    spaces + "auto success = ");
+    "bool " + typeName + "::unmarshal(const DataView& data)\n" +
+    "{\n");
+  if(m_isFixedLayout)
+  {
+    isMatchUnmarshalFunc +=
+      spaces + "m_data = data; // Decode in place, no copy\n" +
+      spaces + offsetName + " = 0;\n" +
+      spaces + "m_needed = m_data.size() < Layout::totalSize ? Layout::totalSize - m_data.size() : 0;\n" +
+      spaces + "if(m_needed > 0) return false; // Fields are read unchecked below\n" +
+      spaces + "auto success = ";
+  }
+  else
+  {
+    //Resume at the field the last call stopped at, so each byte is decoded once.
+    isMatchUnmarshalFunc +=
+      spaces + "//Continue after the last whole field while the buffer only grows.\n" +
+      spaces + "if(data.begin() != m_data.begin() || data.size() < m_data.size())\n" +
+      spaces + spaces + "restart();\n" +
+      spaces + "m_data = data; // Decode in place, no copy\n" +
+      spaces + "m_needed = 0;\n" +
+      spaces + "size_t offset = " + offsetName + ";\n" +
+      spaces + "switch(m_field)\n" +
+      spaces + "{\n";
+  }
   size_t calls = 0;
   auto it = grammarIsMatchSubElements.begin();
   while(it != grammarIsMatchSubElements.end())
@@ -130,13 +924,56 @@ void GrammarElement::generateMarshalUnmarshalFunction()
     auto pCurSe = *it;
     if(!pCurSe->getToken()->isStaticVariable())
     {
-      if(calls > 0)
+      auto pCurInfo = pCurSe->getCppTypeInfo();
+      std::string field(pCurInfo->typeNameStr);
+      std::string checksumBegins, checksumEnds, memberBegins, memberEnds;
+      for(auto& rChecksum : m_checksums)
       {
+        if(field == rChecksum.second.firstField)
+        {
+          checksumBegins += "size_t " + rChecksum.first + "Begin = rData.size();\n" + spaces;
+          memberBegins += "m_" + rChecksum.first + "Begin = ";
+        }
+        if(field == rChecksum.second.lastField)
+        {
+          checksumEnds += "\n" + spaces + "size_t " + rChecksum.first + "End = rData.size();";
+          memberEnds += "m_" + rChecksum.first + "End = ";
+        }
+      }
+      if(calls > 0)
         isMatchMarshalFunc += "\n" + spaces;
-        isMatchUnmarshalFunc += " &&\n" + Utils::getTabSpace(1, 9);
+      //Checksums are computed from the marshaled bytes of the fields they cover.
+      isMatchMarshalFunc += checksumBegins;
+      if(m_checksums.count(field))
+        isMatchMarshalFunc += field + " = " + getChecksumCall(field, "rData.data()", field + "Begin", field + "End") + ";\n" + spaces;
+      isMatchMarshalFunc += pCurInfo->getMarshalCall("", "rData") + ";";
+      isMatchMarshalFunc += checksumEnds;
+      std::string unmarshalOffsetName(m_isFixedLayout ? offsetName : "offset");
+      std::stringstream skipCall;
+      skipCall << "skip(" << unmarshalOffsetName << ", " << pCurInfo->resolvedSizeBytes << ")";
+      std::string unmarshalCall(m_lazyFields.count(pCurInfo->typeNameStr) ?
+        skipCall.str() : pCurInfo->getUnmarshalCall("", unmarshalOffsetName));
+      if(m_isFixedLayout)
+      {
+        if(calls > 0)
+          isMatchUnmarshalFunc += " &&\n" + Utils::getTabSpace(1, 9);
+        isMatchUnmarshalFunc += unmarshalCall;
+      }
+      else
+      {
+        std::stringstream fieldCase;
+        fieldCase << spaces << "case " << calls << ":\n";
+        if(!memberBegins.empty())
+          fieldCase << spaces << spaces << memberBegins << "offset;\n";
+        fieldCase << spaces << spaces << "if(!" << unmarshalCall << ") return suspend("
+                  << (hasStaticSize(pCurInfo) ? pCurInfo->resolvedSizeBytes : 0) << ");\n"
+                  << spaces << spaces << offsetName << " = offset;\n";
+        if(!memberEnds.empty())
+          fieldCase << spaces << spaces << memberEnds << "offset;\n";
+        fieldCase << spaces << spaces << "++m_field;\n"
+                  << spaces << spaces << "// Fall through\n";
+        isMatchUnmarshalFunc += fieldCase.str();
       }
-      isMatchMarshalFunc += pCurSe->getCppTypeInfo()->getMarshalCall("", "rData") + ";";
-      isMatchUnmarshalFunc += pCurSe->getCppTypeInfo()->getUnmarshalCall("", offsetName);
       it = grammarIsMatchSubElements.erase(it);
       ++calls;
     }
@@ -144,13 +981,51 @@ void GrammarElement::generateMarshalUnmarshalFunction()
       ++it;
   }
   isMatchMarshalFunc += "}\n\n";
-  isMatchUnmarshalFunc += ";\n";
-  isMatchUnmarshalFunc += spaces + "if(success) actions();\n";
-  isMatchUnmarshalFunc += spaces + "return success;\n}\n\n";
+  if(m_isFixedLayout)
+  {
+    isMatchUnmarshalFunc += ";\n";
+    isMatchUnmarshalFunc += spaces + "if(success) actions();\n";
+    isMatchUnmarshalFunc += spaces + "return success;\n}\n\n";
+  }
+  else
+  {
+    isMatchUnmarshalFunc +=
+      spaces + "default:\n" +
+      spaces + spaces + "break;\n" +
+      spaces + "}\n" +
+      spaces + "restart(); // The next record starts at the first field\n" +
+      spaces + "actions();\n" +
+      spaces + "return true;\n}\n\n";
+    isMatchUnmarshalFunc +=
+      "bool " + typeName + "::suspend(size_t fieldSize)\n" +
+      "{\n" +
+      spaces + "//Only a short buffer fails a field of unknown size. A field of known\n" +
+      spaces + "//size that fits but fails did not match, so the record starts over.\n" +
+      spaces + "size_t available = m_data.size() - " + offsetName + ";\n" +
+      spaces + "if(0 == fieldSize)\n" +
+      spaces + spaces + "m_needed = 1;\n" +
+      spaces + "else if(fieldSize > available)\n" +
+      spaces + spaces + "m_needed = fieldSize - available;\n" +
+      spaces + "else\n" +
+      spaces + spaces + "restart();\n" +
+      spaces + "return false;\n" +
+      "}\n\n";
+  }
   getCppTypeInfo()->cppStatements.push_back(isMatchMarshalFunc);
   getCppTypeInfo()->cppStatements.push_back(isMatchUnmarshalFunc);
   getCppTypeInfo()->hppStatements.push_back(spaces + "void " + "marshal(std::vector<uint8_t>& rData);\n");
-  getCppTypeInfo()->hppStatements.push_back(spaces + "bool " + "unmarshal(std::vector<uint8_t>& data);\n");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "bool " + "unmarshal(const DataView& data);\n");
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** @return bytes still missing from a record cut short by the end of the input. */\n" +
+    spaces + "size_t needed() const { return m_needed; }\n" +
+    spaces + "/** Make the next unmarshal start a new record. */\n" +
+    spaces + "void restart() { m_field = 0; " + offsetName + " = 0; }\n");
+  if(!m_isFixedLayout)
+  {
+    getCppTypeInfo()->hppStatements.push_back(
+      spaces + "/** Keep the field cursor if the record was cut short. */\n" +
+      spaces + "bool suspend(size_t fieldSize);\n");
+  }
 }
 
 void GrammarElement::generateDeclCode(std::shared_ptr<SubElement> pThisSubElement)
@@ -177,10 +1052,9 @@ void GrammarElement::generateDeclCode(std::shared_ptr<SubElement> pThisSubElemen
       }
       size_t containerSize = 0;
       auto pCppInfo = pCurChild->getCppTypeInfo();
-      if(pCppInfo && pCppInfo->pTypeRange)
-        containerSize = pCppInfo->pTypeRange->getSize();
-      else if(pThisSubElement->getCppTypeInfo() && pThisSubElement->getCppTypeInfo()->pTypeRange)
-        containerSize = pThisSubElement->getCppTypeInfo()->pTypeRange->getSize();
+      auto pRangeInfo = pCppInfo && pCppInfo->pTypeRange ? pCppInfo : pThisSubElement->getCppTypeInfo();
+      if(pRangeInfo && pRangeInfo->pTypeRange)
+        containerSize = pRangeInfo->pTypeRange->getSize();
 
       std::stringstream cppLine;
       if(pThisSubElement->getCppTypeInfo() && pThisSubElement->getCppTypeInfo()->isVector() && containerSize > 0)
@@ -216,6 +1090,17 @@ void GrammarElement::generateDeclCode(std::shared_ptr<SubElement> pThisSubElemen
       {
         hppLineStr = spaces + varType + " " + varName + ";";
       }
+      else if(pThisSubElement->getCppTypeInfo()->isByteField())
+      {
+        hppLineStr = spaces + "ByteField<" + varType + "> " + varName + ";";
+      }
+      else if(containerSize > 0 && containerSize == getStaticCapacity(pRangeInfo))
+      {
+        //The maximum is known, so the items live inside the record instead of on the heap.
+        std::ostringstream boundedLine;
+        boundedLine << spaces << "BoundedVector<" << varType << ", " << containerSize << "> " << varName << ";";
+        hppLineStr = boundedLine.str();
+      }
       else
       {
         hppLineStr = containerSize > 0 || pThisSubElement->getCppTypeInfo()->isVector() ?
@@ -229,16 +1114,38 @@ void GrammarElement::generateDeclCode(std::shared_ptr<SubElement> pThisSubElemen
   }
   else if(pThisSubElement->getToken()->isStaticVariable())
   {
-    std::string hppLineStr(Utils::getTabSpace() + "StaticVariable " + Utils::getCppVarName(pThisSubElement->getToken(), false) + ";\n");
-    if(this->getCppTypeInfo()->hppStatements.empty() ||
-      this->getCppTypeInfo()->hppStatements.back() != hppLineStr)
-      this->getCppTypeInfo()->hppStatements.push_back(hppLineStr);
-
-    if(this->getCppTypeInfo()->hppIncludes.end() ==
-      std::find(this->getCppTypeInfo()->hppIncludes.begin(),
-      this->getCppTypeInfo()->hppIncludes.end(), "#include \"StaticVariable.hpp\"\n"))
+    std::string varName(Utils::getCppVarName(pThisSubElement->getToken(), false));
+    auto typeIt = m_staticVarTypes.find(pThisSubElement->getToken()->text);
+    if(m_staticVarTypes.end() != typeIt)
     {
-      this->getCppTypeInfo()->hppIncludes.push_back("#include \"StaticVariable.hpp\"\n");
+      //Variables that only hold one kind of number are declared with its native type.
+      if(m_initializerListSet.insert(varName).second)
+      {
+        this->getCppTypeInfo()->hppStatements.push_back(Utils::getTabSpace() + typeIt->second + " " + varName + ";\n");
+        if(this->getCppTypeInfo()->cppStatements.back() == ":")
+        {
+          this->getCppTypeInfo()->cppStatements.back().append(Utils::getTabSpace(1, Utils::TAB_SIZE - 1) + varName + "(0)");
+        }
+        else
+        {
+          this->getCppTypeInfo()->cppStatements.back().append(",\n");
+          this->getCppTypeInfo()->cppStatements.push_back(Utils::getTabSpace() + varName + "(0)");
+        }
+      }
+    }
+    else
+    {
+      std::string hppLineStr(Utils::getTabSpace() + "StaticVariable " + varName + ";\n");
+      if(this->getCppTypeInfo()->hppStatements.empty() ||
+        this->getCppTypeInfo()->hppStatements.back() != hppLineStr)
+        this->getCppTypeInfo()->hppStatements.push_back(hppLineStr);
+
+      if(this->getCppTypeInfo()->hppIncludes.end() ==
+        std::find(this->getCppTypeInfo()->hppIncludes.begin(),
+        this->getCppTypeInfo()->hppIncludes.end(), "#include \"StaticVariable.hpp\"\n"))
+      {
+        this->getCppTypeInfo()->hppIncludes.push_back("#include \"StaticVariable.hpp\"\n");
+      }
     }
   }
 
@@ -266,9 +1173,31 @@ void GrammarElement::generateCode(std::shared_ptr<SubElement> pThisSubElement)
   }
 }
 
+void GrammarElement::generateMaterializeFunction()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string lines;
+  //Skipped fields are never read, so only borrowed byte fields are copied.
+  for(std::shared_ptr<SubElement> pChild : getChildren()->children)
+  {
+    if(pChild->getCppTypeInfo() && pChild->getCppTypeInfo()->isByteField())
+      lines += spaces + Utils::getCppVarName(pChild->getCppTypeInfo()) + ".materialize();\n";
+  }
+  this->getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** Copy borrowed fields so this record outlives the input buffer. */\n" +
+    spaces + "void materialize();\n");
+  this->getCppTypeInfo()->cppStatements.push_back(
+    "void " + this->getCppTypeInfo()->getTypeNameStr() + "::materialize()\n"
+    "{\n"
+    + lines
+    + spaces + "m_data = DataView();\n"
+    "}\n\n");
+}
+
 void GrammarElement::generateActionsFunction()
 {
   std::string lines;
+  bool isNoThrow = true; //Cleared by a line that might throw
   std::for_each(getChildren()->children.begin(), getChildren()->children.end(),
     [&](std::shared_ptr<SubElement> pChild)
   {
@@ -277,6 +1206,16 @@ void GrammarElement::generateActionsFunction()
       std::string line;
       auto pSeActionLine = std::dynamic_pointer_cast<SubElementActionLine>(pChild);
       auto rpnTokens = pSeActionLine->getRpnTokens();
+      bool isTyped = rpnTokens.end() != std::find_if(rpnTokens.begin(), rpnTokens.end(),
+        [](std::shared_ptr<Token> pTok)->bool{ return pTok->isSymbolTyped(); });
+      auto pExpr = isTyped ? std::shared_ptr<Expression>() : Expression::parse(rpnTokens);
+      if(pExpr)
+      {
+        pExpr->simplify(this);
+        isNoThrow = isNoThrow && pExpr->isNoThrow(this);
+        rpnTokens.clear();
+        line = pExpr->toCpp();
+      }
       for(size_t i = 0; i < rpnTokens.size(); i++)
       {
         auto pTok = rpnTokens.at(i);
@@ -298,8 +1237,10 @@ void GrammarElement::generateActionsFunction()
               getChildren()->findChild(pLastLastTok->text);
             if(findIt != getCppTypeInfo()->cppStatements.end() && isStaticVarTypeAssignment)
             {
+              //Natively typed variables are already zeroed in the initializer list.
               std::string initSv(Utils::getTabSpace() + Utils::getCppVarName(pLastLastTok, false) + "(static_cast<" + pCppInfo->typeStr + ">(0)),\n");
-              getCppTypeInfo()->cppStatements.insert(findIt, initSv);
+              if(!m_staticVarTypes.count(pLastLastTok->text))
+                getCppTypeInfo()->cppStatements.insert(findIt, initSv);
               line.clear();
             }
           }
@@ -308,13 +1249,31 @@ void GrammarElement::generateActionsFunction()
           line.append(Utils::getCppVarName(pTok));
       }
       if(!line.empty())
-        lines.append(Utils::getTabSpace(2) + line + ";\n");
+      {
+        isNoThrow = isNoThrow && pExpr;
+        lines.append(Utils::getTabSpace(Generator::isInlineActions() ? 1 : 2) + line + ";\n");
+      }
     }
   });
+  std::string spaces = Utils::getTabSpace();
+  if(Generator::isInlineActions())
+  {
+    //Errors reach the catch in the state table's runState(), so the actions stay cheap to call
+    //per record. Only actions that cannot throw are declared noexcept.
+    if(lines.empty())
+      lines = spaces + "/* No actions to execute */\n";
+    std::string noexceptSpec(isNoThrow ? " TEBNF_NOEXCEPT" : "");
+    this->getCppTypeInfo()->hppStatements.push_back(spaces + "void actions()" + noexceptSpec + ";\n");
+    this->getCppTypeInfo()->cppStatements.push_back(
+      "void " + this->getCppTypeInfo()->getTypeNameStr() + "::actions()" + noexceptSpec + "\n"
+      "{\n"
+      + lines
+      + "}\n\n");
+    return;
+  }
   if(lines.empty())
     lines = Utils::getTabSpace(2) + "/* No actions to execute */\n";
-  this->getCppTypeInfo()->hppStatements.push_back(Utils::getTabSpace() + "void actions();\n");
-  std::string spaces = Utils::getTabSpace();
+  this->getCppTypeInfo()->hppStatements.push_back(spaces + "void actions();\n");
   this->getCppTypeInfo()->cppStatements.push_back(
     "void " + this->getCppTypeInfo()->getTypeNameStr() + "::actions()\n"
     "{\n"
@@ -334,6 +1293,71 @@ void GrammarElement::generateActionsFunction()
     "}\n\n");
 }
 
+std::vector<std::shared_ptr<Token> > GrammarElement::getMergedVariables() const
+{
+  //Only numbers add up; StaticVariables may hold anything. Positions, maxima, flags
+  //and last values are kept per shard, since their sum means nothing.
+  std::vector<std::shared_ptr<Token> > vars;
+  std::set<std::string> names;
+  for(std::shared_ptr<SubElement> pSe : getChildren()->children)
+  {
+    if(pSe->getToken()->isStaticVariable() && m_staticVarTypes.count(pSe->getToken()->text) &&
+       m_counterVars.count(pSe->getToken()->text) && names.insert(pSe->getToken()->text).second)
+      vars.push_back(pSe->getToken());
+  }
+  return vars;
+}
+
+void GrammarElement::generateMergeShardsFunction()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->getTypeNameStr());
+  std::string sums;
+  for(std::shared_ptr<Token> pVar : getMergedVariables())
+  {
+    std::string varName(Utils::getCppVarName(pVar, false));
+    sums.append(spaces + spaces + spaces + "pFirst->" + varName + " += rShard." + varName + ";\n");
+  }
+  if(sums.empty())
+    return;
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/** Adds every shard's $ counters into the first shard's, once the state tables stop. @return the first shard. */\n"
+    + spaces + "static " + typeName + "* mergeShards();\n");
+  getCppTypeInfo()->cppStatements.push_back(
+    typeName + "* " + typeName + "::mergeShards()\n"
+    "{\n"
+    + spaces + typeName + "* pFirst = nullptr;\n"
+    + spaces + "shards().forEach([&](" + typeName + "& rShard)\n"
+    + spaces + "{\n"
+    + spaces + spaces + "if(!pFirst)\n"
+    + spaces + spaces + spaces + "pFirst = &rShard;\n"
+    + spaces + spaces + "else\n"
+    + spaces + spaces + "{\n"
+    + sums
+    + spaces + spaces + "}\n"
+    + spaces + "});\n"
+    + spaces + "return pFirst;\n"
+    "}\n\n");
+}
+
+std::string GrammarElement::getMergeShardsReport(const std::string& spaces) const
+{
+  std::string typeName(getCppTypeInfo()->getTypeNameStr());
+  std::string report;
+  for(std::shared_ptr<Token> pVar : getMergedVariables())
+  {
+    //Unary plus prints 8-bit values as numbers.
+    report.append(spaces + Utils::getTabSpace() + "std::cout << \"" + getName() + "." + pVar->text +
+      " = \" << +pMerged->" + Utils::getCppVarName(pVar, false) + " << std::endl;\n");
+  }
+  if(report.empty())
+    return report;
+  return spaces + "if(" + typeName + "* pMerged = " + typeName + "::mergeShards())\n"
+    + spaces + "{\n"
+    + report
+    + spaces + "}\n";
+}
+
 namespace
 {
   size_t marshalLitIdx = 0;
@@ -469,7 +1493,127 @@ namespace
 {
   size_t unmarshalLitIdx = 0;
   std::string unmarshalTypeName;
-  std::string unmarshalReturnVal;
+  //Set while generating a field of a fixed layout grammar.
+  bool unmarshalFixedLayout = false;
+  std::string unmarshalFieldName;
+
+  //Literals expected at one position of a subelement.  More than one literal
+  //means the grammar used the | operator at that position.
+  struct LiteralAlternatives
+  {
+    std::string varName;
+    std::string typeStr;
+    size_t litIdx;
+    size_t litSize;
+    bool isString;
+    std::vector<std::string> literals;
+    std::string lookup; //Table or function in the .cpp deciding the alternatives, if any
+    bool isLookupTable;
+  };
+  std::vector<LiteralAlternatives> unmarshalAlternatives;
+  //Literal checks of each field by "grammar::field", kept for match().
+  std::map<std::string, std::vector<LiteralAlternatives> > matchAlternatives;
+
+  std::string getDispatchKeyType(const LiteralAlternatives& rAlts)
+  {
+    if("float" == rAlts.typeStr || "double" == rAlts.typeStr)
+      return std::string();
+    switch(rAlts.litSize)
+    {
+    case 1: return "uint8_t";
+    case 2: return "uint16_t";
+    case 4: return "uint32_t";
+    case 8: return "uint64_t";
+    default: return std::string();
+    }
+  }
+
+  //@return the lookup of key in the table or switch of rAlts.
+  std::string getLookupCall(const LiteralAlternatives& rAlts, const std::string& key)
+  {
+    return rAlts.isLookupTable ? rAlts.lookup + "[" + key + "]" : rAlts.lookup + "(" + key + ")";
+  }
+
+  /**
+   * Emits the literal checks for an unmarshal function.  Single literals and
+   * strings are compared directly in the returned expression.  Alternatives
+   * are decided with one lookup per position: a 256-entry table for single
+   * byte literals, and a switch on the full-width value for wider literals
+   * (the compiler picks the jump table, hash or search for the case set).
+   * Tables and switches are defined once in the .cpp, so match() uses them too.
+   * @param[in] spaces - indentation of the function body.
+   * @param[out] rImpl - receives the lookups.
+   * @param[out] rLookups - receives the tables and switches.
+   * @return the boolean expression to return, or empty if none.
+   */
+  std::string generateLiteralChecks(const std::string& spaces, std::string& rImpl, std::string& rLookups)
+  {
+    std::string returnVal;
+    auto appendReturnVal = [&](const std::string& cond)
+    {
+      if(!returnVal.empty())
+        returnVal += " &&\n" + spaces + Utils::getTabSpace(1, 7);
+      returnVal += cond;
+    };
+    for(auto& rAlts : unmarshalAlternatives)
+    {
+      std::stringstream field;
+      field << rAlts.varName << "[" << rAlts.litIdx << "]";
+      if(rAlts.isString)
+      {
+        std::string cond;
+        for(auto& lit : rAlts.literals)
+          cond += (cond.empty() ? "" : " || ") + lit + " == " + rAlts.varName;
+        appendReturnVal(rAlts.literals.size() > 1 ? "(" + cond + ")" : cond);
+        continue;
+      }
+      std::string keyType(getDispatchKeyType(rAlts));
+      if(1 == rAlts.literals.size() || keyType.empty())
+      {
+        std::string cond;
+        for(auto& lit : rAlts.literals)
+          cond += (cond.empty() ? "" : " || ") + std::string("Conversion::compare(&") + field.str() + ", " + lit + ")";
+        appendReturnVal(rAlts.literals.size() > 1 ? "(" + cond + ")" : cond);
+        continue;
+      }
+      std::stringstream lookupIdx;
+      lookupIdx << rAlts.litIdx;
+      rLookups += spaces + "/* Literals " + field.str() + " may hold. */\n";
+      if(1 == rAlts.litSize)
+      {
+        rAlts.lookup = "s_" + rAlts.varName + "Alts" + lookupIdx.str();
+        rAlts.isLookupTable = true;
+        rLookups += spaces + "const std::array<bool, 256> " + rAlts.lookup + " = []\n";
+        rLookups += spaces + "{\n";
+        rLookups += spaces + spaces + "std::array<bool, 256> table = {};\n";
+        rLookups += spaces + spaces + "for(uint8_t lit : {";
+        for(size_t i = 0; i < rAlts.literals.size(); ++i)
+          rLookups += (i > 0 ? ", " : " ") + std::string("static_cast<uint8_t>(") + rAlts.literals[i] + ")";
+        rLookups += " }) table[lit] = true;\n";
+        rLookups += spaces + spaces + "return table;\n";
+        rLookups += spaces + "}();\n\n";
+      }
+      else
+      {
+        rAlts.lookup = "is_" + rAlts.varName + "Alt" + lookupIdx.str();
+        rAlts.isLookupTable = false;
+        rLookups += spaces + "bool " + rAlts.lookup + "(" + keyType + " value)\n";
+        rLookups += spaces + "{\n";
+        rLookups += spaces + spaces + "switch(value)\n";
+        rLookups += spaces + spaces + "{\n";
+        for(auto& lit : rAlts.literals)
+          rLookups += spaces + spaces + "case static_cast<" + keyType + ">(" + lit + "):\n";
+        rLookups += spaces + spaces + spaces + "return true;\n";
+        rLookups += spaces + spaces + "default:\n";
+        rLookups += spaces + spaces + spaces + "return false;\n";
+        rLookups += spaces + spaces + "}\n";
+        rLookups += spaces + "}\n\n";
+      }
+      std::string key("Conversion::peek<" + keyType + ">(&" + field.str() + ")");
+      rImpl += spaces + "if(!" + getLookupCall(rAlts, key) + ") return false;\n";
+    }
+    return returnVal;
+  }
 
   void getUnmarshalFunctionHelper(CppTypeInfo* pCppInfo,
     const std::string& spaces,
@@ -505,8 +1649,25 @@ namespace
         //Grammar subelement or static variable used as range value.
         auto pElem = pCppInfo->pCppTypeNode->getContainingElement();
         auto pChild = pElem->getChildren()->findChild(pCppInfo->pTypeRange->pMaxToken->text);
+        std::string resizeCall(pCppInfo->isByteField() ? ".expect(" : ".resize(");
         if(pChild)
-          ss << spaces << varName << ".resize(" << Utils::getCppVarName(pChild->getCppTypeInfo()) << ");\n";
+          ss << spaces << varName << resizeCall << Utils::getCppVarName(pChild->getCppTypeInfo()) << ");\n";
+      }
+      if(unmarshalFixedLayout)
+      {
+        //Read at the constant offset; the record length was checked once.
+        std::stringstream pos;
+        pos << "m_data.begin() + Layout::" << unmarshalFieldName << "Offset";
+        if(pCppInfo->isLiteral() && !pCppInfo->isString() && unmarshalLitIdx > 0)
+          pos << " + " << unmarshalLitIdx;
+        if(pCppInfo->isNumStr)
+          ss << spaces << "if(!Conversion::loadNumString(" << pos.str() << ", " << varName << ", " << pCppInfo->resolvedSizeBytes << ")) return false;\n";
+        else if(pCppInfo->isLiteral() && !pCppInfo->isString())
+          ss << spaces << "Conversion::load(" << pos.str() << ", " << varName << "[" << unmarshalLitIdx << "]);\n";
+        else
+          ss << spaces << "Conversion::load(" << pos.str() << ", " << varName << ");\n";
+        rImpl += ss.str();
+        return;
       }
       if(pCppInfo->isNumStr)
         ss << spaces << "if(!Conversion::unmarshalNumString(m_data, " << varName << ", " << pCppInfo->resolvedSizeBytes << ", " << DATA_OFFSET;
@@ -547,8 +1708,11 @@ bool GrammarElement::getUnmarshalFunction(
       return false;
     unmarshalLitIdx = 0;
     unmarshalTypeName.clear();
-    unmarshalReturnVal.clear();
+    unmarshalAlternatives.clear();
+    unmarshalFixedLayout = m_isFixedLayout;
+    unmarshalFieldName = pUnmarshalCppInfo->typeNameStr;
     std::string typeName = pSubElement->getContainingElement()->getCppTypeInfo()->typeNameStr;
+    size_t funcBegin = rImpl.size();
     rImpl += "bool " + typeName + "::unmarshal_" + pUnmarshalCppInfo->typeNameStr + "(size_t& " + DATA_OFFSET + ")\n{\n";
 
     /* if(pUnmarshalCppInfo->pTypeSizeCastSubElement)
@@ -561,7 +1725,8 @@ bool GrammarElement::getUnmarshalFunction(
       getGrammarSize())
     {
       std::string varName(Utils::getCppVarName(pUnmarshalCppInfo));
-      rImpl += spaces + varName + ".resize(" + getGrammarSize()->text + " - rDataOffset);\n";
+      std::string resizeCall(pUnmarshalCppInfo->isByteField() ? ".expect(" : ".resize(");
+      rImpl += spaces + varName + resizeCall + getGrammarSize()->text + " - rDataOffset);\n";
     }
 
     std::string funcImpl;
@@ -571,8 +1736,23 @@ bool GrammarElement::getUnmarshalFunction(
       rImpl += spaces + offsetStr + "\n";
     rImpl += funcImpl;
     spaces = Utils::getTabSpace();
-    rImpl += spaces + "return " + (unmarshalReturnVal.empty() ? "true" : unmarshalReturnVal) + ";\n";
+    if(m_checksums.count(unmarshalFieldName))
+    {
+      //Verified in the decode pass, while the covered bytes are still in cache.
+      std::string checksumCall(m_isFixedLayout ?
+        getLayoutChecksumCall(unmarshalFieldName, "m_data.begin()") :
+        getChecksumCall(unmarshalFieldName, "m_data.begin()", "m_" + unmarshalFieldName + "Begin", "m_" + unmarshalFieldName + "End"));
+      rImpl += spaces + "if(" + unmarshalFieldName + " != " + checksumCall + ") return false;\n";
+    }
+    if(unmarshalFixedLayout)
+      rImpl += spaces + DATA_OFFSET + " = Layout::" + unmarshalFieldName + "Offset + Layout::" + unmarshalFieldName + "Size;\n";
+    std::string lookups;
+    std::string returnVal(generateLiteralChecks(spaces, rImpl, lookups));
+    matchAlternatives[typeName + "::" + unmarshalFieldName] = unmarshalAlternatives;
+    rImpl += spaces + "return " + (returnVal.empty() ? "true" : returnVal) + ";\n";
     rImpl += "}\n\n";
+    if(!lookups.empty())
+      rImpl.insert(funcBegin, "namespace\n{\n" + lookups.substr(0, lookups.size() - 1) + "}\n\n");
     //Function declaration.
     rDecl = spaces + "/** Unmarshal " + pUnmarshalCppInfo->typeNameStr + " from binary to class. */\n" +
       spaces + "bool unmarshal_" + pUnmarshalCppInfo->typeNameStr + "(size_t& " + DATA_OFFSET + ");\n";
@@ -609,21 +1789,28 @@ bool GrammarElement::getUnmarshalFunction(
             std::shared_ptr<SubElement> pNextSe = pSubElement->getChildren()->children.at(i + 1);
             isOrRelationship = Token::OPERATOR_OR == pNextSe->getRelationToSibling().get();
           }
-          std::string retValOp("&&");
-          if(pSe->getRelationToSibling() && Token::OPERATOR_OR == pSe->getRelationToSibling().get())
-            retValOp = "||";
-          std::string litText("static_cast<" + pSe->getCppTypeInfo()->typeStr + ">(" + pSe->getToken()->text + ")");
-          if(!unmarshalReturnVal.empty())
-            unmarshalReturnVal += " " + retValOp + " \n" + spaces + Utils::getTabSpace(1, 7);
+          bool isAlternative = pSe->getRelationToSibling() &&
+            Token::OPERATOR_OR == pSe->getRelationToSibling().get() &&
+            !unmarshalAlternatives.empty();
           size_t litSize = pSe->getCppTypeInfo()->resolvedSizeBytes;
-          if(pUnmarshalCppInfo->isString())
-            unmarshalReturnVal += pSe->getToken()->text + " == " + Utils::getCppVarName(pUnmarshalCppInfo);
-          else
+          if(!isAlternative)
           {
-            std::stringstream ss;
-            ss << "Conversion::compare(&" << Utils::getCppVarName(pUnmarshalCppInfo) << "[" << unmarshalLitIdx << "], " << litText << ")";
-            unmarshalReturnVal += ss.str();
+            LiteralAlternatives alts;
+            alts.varName = Utils::getCppVarName(pUnmarshalCppInfo);
+            alts.typeStr = pSe->getCppTypeInfo()->typeStr;
+            alts.litIdx = unmarshalLitIdx;
+            alts.litSize = litSize;
+            alts.isString = pUnmarshalCppInfo->isString();
+            alts.isLookupTable = false;
+            unmarshalAlternatives.push_back(alts);
           }
+          auto& rAlts = unmarshalAlternatives.back();
+          std::string litText(rAlts.isString ? pSe->getToken()->text :
+            "static_cast<" + pSe->getCppTypeInfo()->typeStr + ">(" + pSe->getToken()->text + ")");
+          if(rAlts.literals.end() == std::find(rAlts.literals.begin(), rAlts.literals.end(), litText))
+            rAlts.literals.push_back(litText);
+          if(litSize != rAlts.litSize)
+            rAlts.litSize = 0; //Mixed widths are compared one at a time.
           if(!isOrRelationship)
           {
             getUnmarshalFunctionHelper(pSe->getParent()->getCppTypeInfo().get(), spaces, rImpl);
@@ -647,3 +1834,305 @@ bool GrammarElement::getUnmarshalFunction(
 
   return true;
 }
+
+bool GrammarElement::canMatch()
+{
+  if(getGrammarSize())
+    return false;
+  //Fields of static size are skipped; others must be counted by an earlier number.
+  std::set<std::string> numberFields;
+  size_t fieldCount = 0;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    if(!pInfo || pInfo->isBitset() || pInfo->diffBytes > 0 || pInfo->pTypeSizeCastSubElement)
+      return false;
+    for(std::shared_ptr<SubElement> pChild : pSe->getChildren()->children)
+    {
+      if(pChild->getToken()->isSymbolGrammar())
+        return false;
+    }
+    if(!hasStaticSize(pInfo) && !numberFields.count(getCountField(pInfo)))
+      return false;
+    if(hasStaticSize(pInfo) && !pInfo->isVector() && !pInfo->isString() && !pInfo->isNumStr)
+      numberFields.insert(pInfo->typeNameStr);
+    ++fieldCount;
+  }
+  return fieldCount > 0;
+}
+
+void GrammarElement::generateMatchFunction()
+{
+  std::string spaces = Utils::getTabSpace();
+  std::string typeName(getCppTypeInfo()->typeNameStr);
+  std::set<std::string> countFields;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(!pSe->getToken()->isStaticVariable())
+      countFields.insert(getCountField(pSe->getCppTypeInfo()));
+  }
+  std::string body;
+  std::vector<std::string> conds;
+  for(std::shared_ptr<SubElement> pSe : getGrammarUnmarshalSubElements())
+  {
+    if(pSe->getToken()->isStaticVariable())
+      continue;
+    auto pInfo = pSe->getCppTypeInfo();
+    std::string name(pInfo->typeNameStr);
+    std::string pos(m_isFixedLayout ? "pRecord + Layout::" + name + "Offset" : "pRecord + offset");
+    //The same literal checks unmarshal_<field>() makes, read straight from the data.
+    std::vector<std::string> fieldConds;
+    for(auto& rAlts : matchAlternatives[typeName + "::" + name])
+    {
+      std::stringstream litPos;
+      litPos << pos;
+      if(rAlts.litIdx > 0)
+        litPos << " + " << rAlts.litIdx;
+      //Alternatives decided by a table or switch use the one unmarshal uses.
+      if(!rAlts.lookup.empty())
+      {
+        fieldConds.push_back(getLookupCall(rAlts, "Conversion::peek<" + getDispatchKeyType(rAlts) + ">(" + litPos.str() + ")"));
+        continue;
+      }
+      std::string cond;
+      for(auto& lit : rAlts.literals)
+      {
+        std::stringstream litCond;
+        if(rAlts.isString)
+          litCond << "0 == memcmp(" << litPos.str() << ", " << lit << ", " << rAlts.litSize << ")";
+        else
+          litCond << "Conversion::peek<" << rAlts.typeStr << ">(" << litPos.str() << ") == " << lit;
+        cond += (cond.empty() ? "" : " || ") + litCond.str();
+      }
+      fieldConds.push_back(rAlts.literals.size() > 1 ? "(" + cond + ")" : cond);
+    }
+    if(m_checksums.count(name))
+    {
+      fieldConds.push_back("Conversion::peek<decltype(" + name + ")>(" + pos + ") == " +
+        (m_isFixedLayout ? getLayoutChecksumCall(name, "pRecord") :
+          getChecksumCall(name, "pRecord", name + "Begin", name + "End")));
+    }
+    if(m_isFixedLayout)
+    {
+      conds.insert(conds.end(), fieldConds.begin(), fieldConds.end());
+      continue;
+    }
+    std::string checksumEnds;
+    for(auto& rChecksum : m_checksums)
+    {
+      if(name == rChecksum.second.firstField)
+        body += spaces + "size_t " + rChecksum.first + "Begin = offset;\n";
+      if(name == rChecksum.second.lastField)
+        checksumEnds += spaces + "size_t " + rChecksum.first + "End = offset;\n";
+    }
+    std::stringstream size;
+    if(hasStaticSize(pInfo))
+      size << pInfo->resolvedSizeBytes;
+    else
+      size << getCountField(pInfo) << "Count * " << pInfo->typeSizeBits / CHAR_BIT;
+    body += spaces + "rConsumed = offset + " + size.str() + ";\n" +
+      spaces + "if(rConsumed > data.size()) return false;\n";
+    for(const std::string& cond : fieldConds)
+      body += spaces + "if(!(" + cond + ")) return false;\n";
+    if(countFields.count(name))
+      body += spaces + "size_t " + name + "Count = Conversion::peek<decltype(" + name + ")>(" + pos + ");\n";
+    body += spaces + "offset = rConsumed;\n" + checksumEnds;
+  }
+  if(m_isFixedLayout)
+  {
+    std::string returnVal;
+    for(const std::string& cond : conds)
+      returnVal += (returnVal.empty() ? "" : " &&\n" + Utils::getTabSpace(1, 9)) + cond;
+    body = spaces + "rConsumed = Layout::totalSize;\n" +
+      spaces + "if(data.size() < Layout::totalSize) return false;\n" +
+      spaces + "const uint8_t* pRecord = data.begin();\n" +
+      spaces + "return " + (returnVal.empty() ? "true" : returnVal) + ";\n";
+  }
+  else
+  {
+    body = spaces + "const uint8_t* pRecord = data.begin();\n" +
+      spaces + "size_t offset = 0;\n" +
+      body +
+      spaces + "return true;\n";
+  }
+  getCppTypeInfo()->hppStatements.push_back(
+    spaces + "/**\n" +
+    spaces + " * Checks the literals, lengths and checksums unmarshal() checks, without\n" +
+    spaces + " * decoding into any member, for rows that only need to know the data matched.\n" +
+    spaces + " * @param[out] rConsumed - the record's length; more than data.size() if the\n" +
+    spaces + " *   data is too short to tell.\n" +
+    spaces + " */\n" +
+    spaces + "bool match(const DataView& data, size_t& rConsumed) const;\n");
+  getCppTypeInfo()->cppStatements.push_back(
+    "bool " + getCppTypeInfo()->getTypeNameStr() + "::match(const DataView& data, size_t& rConsumed) const\n"
+    "{\n" +
+    body +
+    "}\n\n");
+}
+
+void GrammarElement::findCounterVariables()
+{
+  m_counterVars.clear();
+  std::string grammarName(getName());
+  //False once a variable is written any other way than by adding to it, or used as an index.
+  std::map<std::string, bool> counters;
+  auto checkLine = [&](SubElementActionLine* pLine, Element* pScope)
+  {
+    auto isOwnVariable = [&](std::shared_ptr<Token> pTok)->bool
+    {
+      return pTok->isStaticVariable() && (pTok->pAccessedElementToken ?
+        grammarName == pTok->pAccessedElementToken->text : this == pScope);
+    };
+    auto tokens = pLine->getRpnTokens();
+    size_t indexDepth = 0;
+    for(size_t i = 0; i < tokens.size(); i++)
+    {
+      auto pTok = tokens.at(i);
+      if(pTok->isOperatorLeftArrayBracket())
+        indexDepth++;
+      else if(pTok->isOperatorRightArrayBracket() && indexDepth > 0)
+        indexDepth--;
+      else if(isOwnVariable(pTok) && indexDepth > 0)
+        counters[pTok->text] = false;
+      else if(isOwnVariable(pTok) && i + 1 < tokens.size() &&
+              (Token::OPERATOR_INCREMENT == tokens.at(i + 1)->type || Token::OPERATOR_DECREMENT == tokens.at(i + 1)->type))
+        counters.insert(std::make_pair(pTok->text, true));
+    }
+    //The tokens are in the order written, so an assignment is $x op ...
+    if(tokens.size() < 3 || !isOwnVariable(tokens.front()) || !tokens.at(1)->isOperatorAssignment())
+      return;
+    std::string var(tokens.front()->text);
+    Token::TokenType assignType = tokens.at(1)->type;
+    //$x += y, $x -= y and $x = $x + y add to the variable; $x = 0 in the grammar sets where it starts.
+    bool isAdded = Token::OPERATOR_ASSIGN_INCREMENT == assignType || Token::OPERATOR_ASSIGN_DECREMENT == assignType ||
+      (Token::OPERATOR_ASSIGN == assignType && 5 == tokens.size() && isOwnVariable(tokens.at(2)) &&
+       var == tokens.at(2)->text && ("+" == tokens.at(3)->text || "-" == tokens.at(3)->text));
+    //Numbers in lines are not always typed as literals, see getValueKind().
+    const std::string& value = tokens.back()->text;
+    bool isInitialized = Token::OPERATOR_ASSIGN == assignType && 3 == tokens.size() && this == pScope &&
+      (tokens.back()->isLiteralNumber() || (!value.empty() && std::isdigit(static_cast<unsigned char>(value[0]))));
+    if(isAdded)
+      counters.insert(std::make_pair(var, true));
+    else if(!isInitialized)
+      counters[var] = false;
+  };
+  for(std::shared_ptr<Element> pElement : Elements::elements())
+  {
+    for(std::shared_ptr<SubElement> pSe : pElement->getChildren()->children)
+    {
+      std::vector<Node*> lines(1, pSe.get());
+      if(pSe->isType("SubElementState"))
+      {
+        auto pRow = reinterpret_cast<SubElementState*>(pSe.get());
+        lines.assign({ pRow->getInputOrCondition().get(), pRow->getOutputOrAction().get() });
+      }
+      for(Node* pLine : lines)
+      {
+        if(pLine && pLine->isType("SubElementActionLine"))
+          checkLine(reinterpret_cast<SubElementActionLine*>(pLine), pElement.get());
+      }
+    }
+  }
+  for(auto it = counters.begin(); it != counters.end(); ++it)
+  {
+    if(it->second)
+      m_counterVars.insert(it->first);
+  }
+}
+
+void GrammarElement::inferStaticVariableTypes()
+{
+  m_staticVarTypes.clear();
+  std::string grammarName(getName());
+  //Variables combined in one expression share a type, so they are unified.
+  std::map<std::string, std::string> parents;
+  std::map<std::string, int> kinds;
+  auto findRoot = [&](std::string var)->std::string
+  {
+    while(parents.count(var) && parents[var] != var)
+      var = parents[var];
+    return var;
+  };
+  auto unifyLine = [&](SubElementActionLine* pLine, Element* pScope)
+  {
+    //Each bracketed index is an expression of its own.
+    std::vector<std::pair<int, std::vector<std::string> > > groups(1);
+    std::vector<size_t> openGroups(1, 0);
+    auto rpnTokens = pLine->getRpnTokens();
+    for(size_t i = 0; i < rpnTokens.size(); i++)
+    {
+      auto pTok = rpnTokens.at(i);
+      if(pTok->isOperatorLeftArrayBracket())
+      {
+        groups.push_back(std::make_pair(0, std::vector<std::string>()));
+        openGroups.push_back(groups.size() - 1);
+        continue;
+      }
+      if(pTok->isOperatorRightArrayBracket() && openGroups.size() > 1)
+        openGroups.pop_back();
+      if(pTok->isOperator())
+        continue;
+      auto& rGroup = groups.at(openGroups.back());
+      bool isIndexed = i + 1 < rpnTokens.size() && rpnTokens.at(i + 1)->isOperatorLeftArrayBracket();
+      bool isOwnVariable = pTok->isStaticVariable() && !isIndexed && (pTok->pAccessedElementToken ?
+        grammarName == pTok->pAccessedElementToken->text : this == pScope);
+      if(isOwnVariable)
+        rGroup.second.push_back(pTok->text);
+      else
+        rGroup.first |= getValueKind(pTok, pScope, isIndexed);
+    }
+    for(auto& rGroup : groups)
+    {
+      for(const std::string& var : rGroup.second)
+      {
+        kinds[var] |= rGroup.first;
+        parents[findRoot(var)] = findRoot(rGroup.second.front());
+      }
+    }
+  };
+  for(std::shared_ptr<SubElement> pChild : getChildren()->children)
+  {
+    if(pChild->getToken()->isStaticVariable() && pChild->isType("SubElementActionLine"))
+      unifyLine(reinterpret_cast<SubElementActionLine*>(pChild.get()), this);
+  }
+  if(kinds.empty())
+    return;
+  for(std::shared_ptr<Element> pElement : Elements::elements())
+  {
+    if(pElement.get() == this)
+      continue;
+    for(std::shared_ptr<SubElement> pSe : pElement->getChildren()->children)
+    {
+      std::vector<Node*> lines(1, pSe.get());
+      if(pSe->isType("SubElementState"))
+      {
+        auto pRow = reinterpret_cast<SubElementState*>(pSe.get());
+        lines.assign({ pRow->getInputOrCondition().get(), pRow->getOutputOrAction().get() });
+      }
+      for(Node* pLine : lines)
+      {
+        if(pLine && pLine->isType("SubElementActionLine"))
+          unifyLine(reinterpret_cast<SubElementActionLine*>(pLine), pElement.get());
+      }
+    }
+  }
+  std::map<std::string, int> rootKinds;
+  for(auto it = kinds.begin(); it != kinds.end(); ++it)
+    rootKinds[findRoot(it->first)] |= it->second;
+  for(auto it = kinds.begin(); it != kinds.end(); ++it)
+  {
+    //Variables given more than one kind of number, or anything else, stay StaticVariable.
+    int kind = rootKinds[findRoot(it->first)];
+    int numberKinds = kind & (VALUE_KIND_UINT | VALUE_KIND_INT | VALUE_KIND_DOUBLE);
+    if(kind & VALUE_KIND_OTHER)
+      continue;
+    if(VALUE_KIND_UINT == numberKinds)
+      m_staticVarTypes[it->first] = "uint64_t";
+    else if(VALUE_KIND_INT == numberKinds || (0 == numberKinds && (kind & VALUE_KIND_LITERAL)))
+      m_staticVarTypes[it->first] = "int64_t";
+    else if(VALUE_KIND_DOUBLE == numberKinds)
+      m_staticVarTypes[it->first] = "double";
+  }
+}
@@ -11,6 +11,7 @@
 
 #include "Element.hpp"
 
+#include <map>
 #include <set>
 
 struct CppTypeInfo;
@@ -26,15 +27,84 @@ public:
   std::shared_ptr<Token> getGrammarSize() const { return m_pGrammarSizeToken; }
   void setLastTerminalSubElement(std::shared_ptr<SubElement> pLastTerminalSubElement) { m_pLastTerminalSubElement = pLastTerminalSubElement; }
   std::shared_ptr<SubElement> getLastTerminalSubElement() { return m_pLastTerminalSubElement; }
+  /** Gets the bytes a record can start with; false if any are unknown. */
+  bool getFirstBytes(std::set<uint8_t>& rFirstBytes);
+  /** @return true if every field has a static size, so records can go to columnar outputs. */
+  bool isFixedLayout() { return checkFixedLayout(); }
+  /** @return true if every field can be stored directly, so wireSize() and marshalInto() exist. */
+  bool canMarshalInto();
+  /** @return true if marshalIov() exists, i.e. some field is large enough to send in place. */
+  bool canMarshalIov();
+  /** @return true if match() exists and nothing reads the fields, so state tables only validate. */
+  bool isMatchOnly() { return m_isMatchOnly && canMatch(); }
+  /** @return the native type of a static variable, e.g. uint64_t, or empty if it is a StaticVariable. */
+  std::string getStaticVariableType(const std::string& name) const
+  {
+    auto typeIt = m_staticVarTypes.find(name);
+    return m_staticVarTypes.end() != typeIt ? typeIt->second : std::string();
+  }
+  /** @return the code that merges the shards' $ variables and prints the totals, or empty if none merge. */
+  std::string getMergeShardsReport(const std::string& spaces) const;
 private:
+  /** Span of wire bytes a checksum field is computed over. */
+  struct ChecksumCoverage
+  {
+    std::string firstField;
+    std::string lastField;
+    std::string func; //Checksum:: function, e.g. crc32c
+  };
+
+  void findLazyFields();
+
+  void findChecksumFields();
+
+  /** @return a Checksum:: call over the covered bytes, which start at base + begin and stop at base + end. */
+  std::string getChecksumCall(const std::string& field,
+                              const std::string& base,
+                              const std::string& begin,
+                              const std::string& end);
+
+  /** @return a Checksum:: call over the covered bytes of a fixed layout record at base. */
+  std::string getLayoutChecksumCall(const std::string& field, const std::string& base);
+
+  void generateLazyFieldFunctions();
+
+  bool checkFixedLayout();
+
+  void generateFixedLayout();
+
+  void generateDecodeAllFunction();
+
+  void generateColumnFunctions();
+
+  void generateMarshalIntoFunction();
+
+  void generateMarshalIovFunction();
+
+  bool canMatch();
+
+  void generateMatchFunction();
+
   void generateMarshalUnmarshalFunction();
 
   void generateDeclCode(std::shared_ptr<SubElement> pThisSubElement);
 
   void generateCode(std::shared_ptr<SubElement> pThisSubElement);
 
+  void generateMaterializeFunction();
+
   void generateActionsFunction();
 
+  /** @return the $ variables that mergeShards() adds up: counters with a native type. */
+  std::vector<std::shared_ptr<Token> > getMergedVariables() const;
+
+  /** Finds the $ variables that are only ever added to, see m_counterVars. */
+  void findCounterVariables();
+
+  void generateMergeShardsFunction();
+
+  void inferStaticVariableTypes();
+
   bool getMarshalFunction(
     std::shared_ptr<CppTypeInfo> pMarshalCppInfo,
     std::shared_ptr<SubElement> pSubElement,
@@ -53,6 +123,17 @@ private:
   std::set<std::string> m_initializerListSet;
   std::shared_ptr<Token> m_pGrammarSizeToken;
   std::shared_ptr<SubElement> m_pLastTerminalSubElement;
+  bool m_isFixedLayout;
+  bool m_isMatchOnly;
+  size_t m_iovScratchSize;
+  /** Fields no state or action reads, which unmarshal skips. */
+  std::set<std::string> m_lazyFields;
+  /** Checksum fields by name. */
+  std::map<std::string, ChecksumCoverage> m_checksums;
+  /** Native types of the static variables that only ever hold one kind of number. */
+  std::map<std::string, std::string> m_staticVarTypes;
+  /** Static variables that every write adds to or subtracts from, and that are no index, so their shards add up. */
+  std::set<std::string> m_counterVars;
 };
 
 #endif //GRAMMARELEMENT_HPP
@@ -3,6 +3,7 @@
 #include "IoElement.hpp"
 
 #include "Elements.hpp"
+#include "../Generator.hpp"
 
 void IoElement::generateCode()
 {
@@ -22,7 +23,7 @@ void IoElement::generateCode()
   case Types::ELEMENT_TYPE_IO_INPUT_UDP_IP: //Fall-through since both input and output use same socket class.
   case Types::ELEMENT_TYPE_IO_OUTPUT_UDP_IP:
     getCppTypeInfo()->hppStatements.push_back(generateUdpSocketHpp(typeName));
-    getCppTypeInfo()->cppStatements.push_back(generateUdpSocketCpp(typeName));
+    getCppTypeInfo()->cppStatements.push_back(generateUdpSocketCpp(typeName, Types::ELEMENT_TYPE_IO_INPUT_UDP_IP == elemType));
     getCppTypeInfo()->supportClasses.push_back(generateWsaSessionHpp());
     break;
   case Types::ELEMENT_TYPE_IO_INPUT_CONSOLE:
@@ -34,6 +35,10 @@ void IoElement::generateCode()
     getCppTypeInfo()->hppStatements.push_back(generateFileIoHpp(typeName));
     getCppTypeInfo()->cppStatements.push_back(generateFileIoCpp(typeName));
     break;
+  case Types::ELEMENT_TYPE_IO_OUTPUT_COLUMNS:
+    getCppTypeInfo()->hppStatements.push_back(generateColumnsIoHpp(typeName));
+    getCppTypeInfo()->cppStatements.push_back(generateColumnsIoCpp(typeName));
+    break;
   case Types::ELEMENT_TYPE_IO_INPUT_GUI:
   case Types::ELEMENT_TYPE_IO_OUTPUT_GUI:
   case Types::ELEMENT_TYPE_IO_INPUT_MYSQL:
@@ -60,7 +65,6 @@ std::string IoElement::generateConsoleIoHpp(const std::string& typeName, const I
     "#include <iomanip>\n"
     "#include <iostream>\n"
     "#include <memory>\n"
-    "#include <mutex>\n"
     "#include <string>\n"
     "#include <vector>\n\n"
 
@@ -68,8 +72,7 @@ std::string IoElement::generateConsoleIoHpp(const std::string& typeName, const I
     "{\n"
     "public:\n"
     + spc + "std::vector<uint8_t> m_data;\n"
-    + spc + "size_t m_offset;\n"
-    + spc + "std::mutex m_mutex;\n\n"
+    + spc + "size_t m_offset;\n\n"
 
     + spc + typeName + "() : m_data(), m_offset(0) {}\n"
 
@@ -94,15 +97,10 @@ std::string IoElement::generateConsoleIoHpp(const std::string& typeName, const I
     + spc + spc + "return true;\n"
     + spc + "}\n\n"
 
-    + spc + "void adjust(bool /* doAdjustment */) {} // Unneeded for console IO.\n\n"
+    + spc + "void adjust(bool /* doAdjustment */, size_t /* needed */ = 0) {} // Unneeded for console IO.\n\n"
 
-    + spc + "static std::shared_ptr<" + typeName + "> get()\n"
-    + spc + "{\n"
-    + spc + spc + "std::lock_guard<std::mutex> lock(m_mutex);\n"
-    + spc + spc + "static auto pInstance = std::make_shared<" + typeName + ">();\n"
-    + spc + spc + "return pInstance;\n"
-    + spc + "}\n"
-    "};\n");
+    + generateInstanceAccessors(typeName)
+    + "};\n");
   return code;
 }
 
@@ -114,9 +112,21 @@ std::shared_ptr<SupportClass> IoElement::generateWsaSessionHpp()
     "#ifndef WSASESSION_HPP\n"
     "#define WSASESSION_HPP\n\n"
 
-    "#include <Winsock2.h>\n\n");
-
-  pSupCls->hppStatements.push_back("class WSASession\n"
+    "#if defined(_WIN32) || defined(_WIN64)\n"
+    "#include <Winsock2.h>\n"
+    "#else\n"
+    "#include <arpa/inet.h>\n"
+    "#include <cerrno>\n"
+    "#include <netinet/in.h>\n"
+    "#include <sys/ioctl.h>\n"
+    "#include <sys/socket.h>\n"
+    "#include <sys/uio.h>\n"
+    "#include <unistd.h>\n"
+    "#endif\n\n");
+
+  pSupCls->hppStatements.push_back(
+    "#if defined(_WIN32) || defined(_WIN64)\n"
+    "class WSASession\n"
     "{\n"
     "public:\n"
     + spc + "WSASession()"
@@ -128,7 +138,29 @@ std::shared_ptr<SupportClass> IoElement::generateWsaSessionHpp()
     + spc + "~WSASession() { WSACleanup(); }\n"
     "private:\n"
     + spc + "WSAData m_data;\n"
-    "};\n\n"
+    "};\n"
+    "#else\n"
+    "//POSIX sockets need no session, and take the Winsock names the socket classes use.\n"
+    "class WSASession\n"
+    "{\n"
+    "public:\n"
+    + spc + "WSASession() {}\n"
+    "};\n"
+    "typedef int SOCKET;\n"
+    "typedef sockaddr SOCKADDR;\n"
+    "static const SOCKET INVALID_SOCKET = -1;\n"
+    "static const int SOCKET_ERROR = -1;\n"
+    "inline int closesocket(SOCKET sock) { return close(sock); }\n"
+    "inline int WSAGetLastError() { return errno; }\n"
+    "inline int InetPton(int family, const char* pAddress, void* pDest) { return inet_pton(family, pAddress, pDest); }\n"
+    "inline int ioctlsocket(SOCKET sock, long cmd, unsigned long* pArg)\n"
+    "{\n"
+    + spc + "int value = 0;\n"
+    + spc + "int ret = ioctl(sock, cmd, &value);\n"
+    + spc + "*pArg = static_cast<unsigned long>(value);\n"
+    + spc + "return ret;\n"
+    "}\n"
+    "#endif\n\n"
 
     "#endif //WSASESSION_HPP\n\n");
 
@@ -139,57 +171,139 @@ std::shared_ptr<SupportClass> IoElement::generateWsaSessionHpp()
 std::string IoElement::generateUdpSocketHpp(const std::string& typeName)
 {
   std::string spc = Utils::getTabSpace();
+  std::string createWithPort(
+    spc + "static void create(unsigned short port, const std::string& address = std::string(\"\"))\n"
+    + spc + "{\n"
+    + spc + spc + "static " + typeName + " s_instance(port, address);\n"
+    + spc + spc + "instance() = &s_instance;\n"
+    + spc + "}\n");
+  std::string bindPortDecl;
+  if(Generator::isSharded())
+  {
+    createWithPort.assign(
+      spc + "static " + typeName + "* create(size_t shard, unsigned short port, const std::string& address = std::string(\"\"))\n"
+      + spc + "{\n"
+      + spc + spc + "return instance() = shards().get(shard, [&]() { return new " + typeName + "(port, address); });\n"
+      + spc + "}\n");
+    bindPortDecl.assign(spc + "void bindPort();\n");
+  }
   return std::string(
+    "#if defined(_WIN32) || defined(_WIN64)\n"
     "#include <WinSock2.h>\n"
     "#include <WS2tcpip.h>\n"
     "#pragma comment(lib, \"Ws2_32.lib\")\n"
+    "#endif\n"
     "#include <memory>\n"
-    "#include <mutex>\n"
     "#include <string>\n"
     "#include <vector>\n"
+    "#include \"Conversion.hpp\"\n"
     "#include \"WSASession.hpp\"\n"
 
     "class " + typeName + "\n"
     "{\n"
     "public:\n"
-    + spc + "std::vector<uint8_t> m_data;\n"
-    + spc + "size_t m_offset;\n"
-    + spc + "std::mutex m_mutex;\n"
+    + spc + "ByteBuffer m_data;\n"
+    + spc + "size_t m_offset; //Bytes kept for a record that continues in the next datagram\n"
 
     + spc + typeName + "();\n"
     + spc + typeName + "(unsigned short port, const std::string& address = std::string(""));\n"
     + spc + "~" + typeName + "();\n"
     + spc + "void write(const uint8_t* pBuffer, size_t len);\n"
+    + spc + "/** Sends the slices as one datagram without joining them first. */\n"
+    + spc + "void write(const IoSlice* pSlices, size_t count);\n"
     + spc + "bool read(uint8_t* pBuffer, size_t len);\n"
     + spc + "bool read();\n"
-    + spc + "void adjust(bool doAdjustment);\n"
+    + spc + "void adjust(bool doAdjustment, size_t needed = 0);\n"
     + spc + "int getMtuSize();\n"
-    + spc + "static std::shared_ptr<" + typeName + "> get()\n"
-    + spc + "{\n"
-    + spc + spc + "std::lock_guard<std::mutex> lock(m_mutex);\n"
-    + spc + spc + "static auto pInstance = std::make_shared<" + typeName + ">();\n"
-    + spc + spc + "return pInstance;\n"
-    + spc + "}\n"
-    + spc + "static std::shared_ptr<" + typeName + "> get(unsigned short port, const std::string& address = std::string(""))\n"
-    + spc + "{\n"
-    + spc + spc + "static auto pInstance = std::make_shared<" + typeName + ">(port, address);\n"
-    + spc + spc + "return pInstance;\n"
-    + spc + "}\n"
+    + spc + "/** @return the socket, so a state table can wait for it to be readable. */\n"
+    + spc + "SOCKET getSocket() const { return m_sock; }\n"
+    + generateInstanceAccessors(typeName)
+    + createWithPort +
     "private:\n"
+    + spc + "SOCKADDR* getDestination();\n"
+    + bindPortDecl
     + spc + "std::shared_ptr<sockaddr_in> m_pSockAddressIn;\n"
     + spc + "SOCKET m_sock;\n"
     + spc + "std::string m_address;\n"
     + spc + "unsigned short m_port;\n"
     + spc + "int m_mtuMaxSize;\n"
     + spc + "size_t m_readLen;\n"
+    + spc + "std::vector<uint8_t> m_joined; //Slices of records too big for one datagram\n"
+    "#if defined(_WIN32) || defined(_WIN64)\n"
+    + spc + "std::vector<WSABUF> m_buffers; //Reused by each gathered send\n"
+    "#else\n"
+    + spc + "std::vector<iovec> m_buffers; //Reused by each gathered send\n"
+    "#endif\n"
     "};\n\n");
 }
 
 //static
-std::string IoElement::generateUdpSocketCpp(const std::string& typeName)
+std::string IoElement::generateUdpSocketCpp(const std::string& typeName, bool isInput)
 {
   std::string spc = Utils::getTabSpace();
+  std::string prompts(
+    spc + "std::cout << \"IP address: \";\n"
+    + spc + "std::cin >> m_address;\n"
+    + spc + "std::cout << \"Port number: \";\n"
+    + spc + "std::cin >> m_port;\n"
+    + spc + "std::cout << std::endl;\n");
+  std::string bindPort(
+    spc + spc + "sockaddr_in add;\n"
+    + spc + spc + "add.sin_family = AF_INET;\n"
+    + spc + spc + "add.sin_addr.s_addr = htonl(INADDR_ANY);\n"
+    + spc + spc + "add.sin_port = htons(m_port);\n"
+    + spc + spc + "if(bind(m_sock, reinterpret_cast<SOCKADDR*>(&add), sizeof(add)) < 0)\n"
+    + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"Bind failed\");\n");
+  std::string bindPortImpl;
+  if(!Generator::isSharded() && isInput)
+  {
+    //An input listens on the port it was given.
+    prompts.append(
+      spc + "sockaddr_in add;\n"
+      + spc + "add.sin_family = AF_INET;\n"
+      + spc + "add.sin_addr.s_addr = htonl(INADDR_ANY);\n"
+      + spc + "add.sin_port = htons(m_port);\n"
+      + spc + "if(bind(m_sock, reinterpret_cast<SOCKADDR*>(&add), sizeof(add)) < 0)\n"
+      + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"Bind failed\");\n");
+  }
+  else if(Generator::isSharded())
+  {
+    //Shards are constructed one after another, so later ones reuse the first answers.
+    prompts.assign(
+      spc + "static std::string s_address;\n"
+      + spc + "static unsigned short s_port = 0;\n"
+      + spc + "if(0 == s_port)\n"
+      + spc + "{\n"
+      + spc + spc + "std::cout << \"IP address: \";\n"
+      + spc + spc + "std::cin >> s_address;\n"
+      + spc + spc + "std::cout << \"Port number: \";\n"
+      + spc + spc + "std::cin >> s_port;\n"
+      + spc + spc + "std::cout << std::endl;\n"
+      + spc + "}\n"
+      + spc + "m_address = s_address;\n"
+      + spc + "m_port = s_port;\n");
+    if(isInput)
+      prompts.append(spc + "bindPort();\n");
+    bindPort.assign(spc + spc + "bindPort();\n");
+    bindPortImpl.assign(
+      "void " + typeName + "::bindPort()\n"
+      "{\n"
+      + spc + "sockaddr_in add;\n"
+      + spc + "add.sin_family = AF_INET;\n"
+      + spc + "add.sin_addr.s_addr = htonl(INADDR_ANY);\n"
+      + spc + "add.sin_port = htons(m_port);\n"
+      "#if defined(SO_REUSEPORT)\n"
+      + spc + "//Every shard binds the port and the kernel spreads flows across them\n"
+      + spc + "int reuse = 1;\n"
+      + spc + "if(setsockopt(m_sock, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&reuse), sizeof(reuse)) < 0)\n"
+      + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"Error sharing port\");\n"
+      "#endif\n"
+      + spc + "if(bind(m_sock, reinterpret_cast<SOCKADDR*>(&add), sizeof(add)) < 0)\n"
+      + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"Bind failed\");\n"
+      "}\n\n");
+  }
   return std::string("//System includes:\n"
+    "#include <algorithm>\n"
     "#include <system_error>\n"
     "#include <iostream>\n\n"
 
@@ -201,13 +315,11 @@ std::string IoElement::generateUdpSocketCpp(const std::string& typeName)
     + spc + "m_address(),\n"
     + spc + "m_port(),\n"
     + spc + "m_mtuMaxSize(-1),\n"
-    + spc + "m_readLen(0)\n"
+    + spc + "m_readLen(0),\n"
+    + spc + "m_joined(),\n"
+    + spc + "m_buffers()\n"
     "{\n"
-    + spc + "std::cout << \"IP address: \";\n"
-    + spc + "std::cin >> m_address;\n"
-    + spc + "std::cout << \"Port number: \";\n"
-    + spc + "std::cin >> m_port;\n"
-    + spc + "std::cout << std::endl;\n"
+    + prompts +
     "}\n\n"
     + typeName + "::" + typeName + "(unsigned short port, const std::string& address)\n"
     ": m_data(),\n"
@@ -217,18 +329,15 @@ std::string IoElement::generateUdpSocketCpp(const std::string& typeName)
     + spc + "m_address(address),\n"
     + spc + "m_port(port),\n"
     + spc + "m_mtuMaxSize(-1),\n"
-    + spc + "m_readLen(0)\n"
+    + spc + "m_readLen(0),\n"
+    + spc + "m_joined(),\n"
+    + spc + "m_buffers()\n"
     "{\n"
     + spc + "if(m_sock == INVALID_SOCKET)\n"
     + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"Error opening socket\");\n"
     + spc + "if(m_address.empty())\n"
     + spc + "{\n"
-    + spc + spc + "sockaddr_in add;\n"
-    + spc + spc + "add.sin_family = AF_INET;\n"
-    + spc + spc + "add.sin_addr.s_addr = htonl(INADDR_ANY);\n"
-    + spc + spc + "add.sin_port = htons(m_port);\n"
-    + spc + spc + "if(bind(m_sock, reinterpret_cast<SOCKADDR*>(&add), sizeof(add)) < 0)\n"
-    + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"Bind failed\");\n"
+    + bindPort
     + spc + "}\n"
     + spc + "getMtuSize();\n"
     "}\n\n" +
@@ -238,19 +347,23 @@ std::string IoElement::generateUdpSocketCpp(const std::string& typeName)
     + spc + "closesocket(m_sock);\n"
     "}\n\n"
 
-    "void " + typeName + "::write(const uint8_t* pBuffer, size_t len)\n"
+    + bindPortImpl +
+
+    "SOCKADDR* " + typeName + "::getDestination()\n"
     "{\n"
-    + spc + "SOCKADDR* pSockAddr = NULL;\n"
-    + spc + "if(m_address.empty())\n"
-    + spc + spc + "pSockAddr = reinterpret_cast<SOCKADDR*>(m_pSockAddressIn.get());\n"
-    + spc + "else\n"
+    + spc + "if(!m_address.empty())\n"
     + spc + "{\n"
     + spc + spc + "m_pSockAddressIn->sin_family = AF_INET;\n"
     + spc + spc + "m_pSockAddressIn->sin_port = htons(m_port);\n"
     + spc + spc + "if(1 != InetPton(AF_INET, m_address.c_str(), &(m_pSockAddressIn->sin_addr.s_addr)))\n"
     + spc + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"write failed\");\n"
-    + spc + spc + "pSockAddr = reinterpret_cast<SOCKADDR *>(m_pSockAddressIn.get());\n"
     + spc + "}\n"
+    + spc + "return reinterpret_cast<SOCKADDR*>(m_pSockAddressIn.get());\n"
+    "}\n\n"
+
+    "void " + typeName + "::write(const uint8_t* pBuffer, size_t len)\n"
+    "{\n"
+    + spc + "SOCKADDR* pSockAddr = getDestination();\n"
     + spc + "int currentLen = static_cast<int>(len);\n"
     + spc + "while(currentLen > 0)\n"
     + spc + "{\n"
@@ -262,43 +375,95 @@ std::string IoElement::generateUdpSocketCpp(const std::string& typeName)
     + spc + "}\n"
     "}\n\n"
 
+    "void " + typeName + "::write(const IoSlice* pSlices, size_t count)\n"
+    "{\n"
+    + spc + "size_t len = 0;\n"
+    + spc + "for(size_t i = 0; i < count; ++i)\n"
+    + spc + spc + "len += pSlices[i].len;\n"
+    + spc + "if(len > static_cast<size_t>(getMtuSize()))\n"
+    + spc + "{\n"
+    + spc + spc + "//Records split across datagrams are joined and sent in MTU sized pieces.\n"
+    + spc + spc + "m_joined.clear();\n"
+    + spc + spc + "for(size_t i = 0; i < count; ++i)\n"
+    + spc + spc + spc + "m_joined.insert(m_joined.end(), pSlices[i].pData, pSlices[i].pData + pSlices[i].len);\n"
+    + spc + spc + "write(m_joined.data(), m_joined.size());\n"
+    + spc + spc + "return;\n"
+    + spc + "}\n"
+    + spc + "m_buffers.resize(count);\n"
+    + spc + "SOCKADDR* pSockAddr = getDestination();\n"
+    "#if defined(_WIN32) || defined(_WIN64)\n"
+    + spc + "for(size_t i = 0; i < count; ++i)\n"
+    + spc + "{\n"
+    + spc + spc + "m_buffers[i].len = static_cast<ULONG>(pSlices[i].len);\n"
+    + spc + spc + "m_buffers[i].buf = reinterpret_cast<CHAR*>(const_cast<uint8_t*>(pSlices[i].pData));\n"
+    + spc + "}\n"
+    + spc + "DWORD sent = 0;\n"
+    + spc + "if(SOCKET_ERROR == WSASendTo(m_sock, m_buffers.data(), static_cast<DWORD>(count), &sent, 0, pSockAddr, sizeof(*pSockAddr), nullptr, nullptr))\n"
+    + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"write failed\");\n"
+    "#else\n"
+    + spc + "for(size_t i = 0; i < count; ++i)\n"
+    + spc + "{\n"
+    + spc + spc + "m_buffers[i].iov_len = pSlices[i].len;\n"
+    + spc + spc + "m_buffers[i].iov_base = const_cast<uint8_t*>(pSlices[i].pData);\n"
+    + spc + "}\n"
+    + spc + "msghdr message = {};\n"
+    + spc + "message.msg_name = pSockAddr;\n"
+    + spc + "message.msg_namelen = sizeof(sockaddr_in);\n"
+    + spc + "message.msg_iov = m_buffers.data();\n"
+    + spc + "message.msg_iovlen = count;\n"
+    + spc + "if(sendmsg(m_sock, &message, 0) < 0)\n"
+    + spc + spc + "throw std::system_error(WSAGetLastError(), std::system_category(), \"write failed\");\n"
+    "#endif\n"
+    "}\n\n"
+
     "bool " + typeName + "::read(uint8_t* pBuffer, size_t len)\n"
     "{\n"
     + spc + "sockaddr_in from;\n"
-    + spc + "int size = sizeof(from);\n"
+    + spc + "socklen_t size = sizeof(from);\n"
     + spc + "int ret = recvfrom(m_sock, reinterpret_cast<char*>(pBuffer), static_cast<int>(len), 0, reinterpret_cast<SOCKADDR*>(&from), &size);\n"
     + spc + "if(ret < 0) return false;\n"    
+    + spc + "m_readLen = static_cast<size_t>(ret);\n"
     + spc + "m_pSockAddressIn = std::make_shared<sockaddr_in>(from);\n"
     + spc + "return ret > 0;\n"
     "}\n\n"
 
     "bool " + typeName + "::read()\n"
     "{\n"
-    + spc + "m_readLen = getMtuSize();\n"
-    + spc + "if(m_data.empty()) m_data.resize(m_readLen);\n"
-    + spc + "return read(&m_data[m_offset], m_readLen);\n"
+    + spc + "//Datagrams are appended after the bytes kept for a record that spans several.\n"
+    + spc + "//The waiting datagram's size sets the room made for it, and the buffer does\n"
+    + spc + "//not zero-fill, so kept bytes stay where grammars borrowed them.\n"
+    + spc + "unsigned long pending = 0;\n"
+    + spc + "if(ioctlsocket(m_sock, FIONREAD, &pending) < 0 || 0 == pending)\n"
+    + spc + spc + "pending = static_cast<unsigned long>(getMtuSize());\n"
+    + spc + "m_data.resize(m_offset + pending);\n"
+    + spc + "m_readLen = 0;\n"
+    + spc + "bool isRead = read(m_data.data() + m_offset, pending);\n"
+    + spc + "m_data.resize(m_offset + m_readLen);\n"
+    + spc + "return isRead;\n"
     "}\n\n"
 
-    "void " + typeName + "::adjust(bool doAdjustment)\n"
+    "void " + typeName + "::adjust(bool doAdjustment, size_t needed)\n"
     "{\n"
-    + spc + "if(doAdjustment)\n"
-    + spc + "{\n"
-    + spc + spc + "m_offset += m_readLen;\n"
-    + spc + spc + "m_data.resize(m_data.size() + m_readLen); /*Make room for next read*/\n"
-    + spc + "}\n"
+    + spc + "//Keep the datagrams read so far only while a grammar waits for the rest of\n"
+    + spc + "//its record. Otherwise they were used or did not match, so they are dropped\n"
+    + spc + "//and the next datagram is read to the start of the buffer.\n"
+    + spc + "if(doAdjustment && needed > 0)\n"
+    + spc + spc + "m_offset = m_data.size();\n"
     + spc + "else\n"
-    + spc + "{\n"
     + spc + spc + "m_offset = 0;\n"
-    + spc + "}\n"
     "}\n\n"
 
     "int " + typeName + "::getMtuSize()\n"
     "{\n"
     + spc + "if(-1 == m_mtuMaxSize)\n"
     + spc + "{\n"
+    "#if defined(_WIN32) || defined(_WIN64)\n"
     + spc + "  int iSize = sizeof(m_mtuMaxSize);\n"
     + spc + "  if(SOCKET_ERROR == getsockopt(m_sock, SOL_SOCKET, SO_MAX_MSG_SIZE, reinterpret_cast<char*>(&m_mtuMaxSize), &iSize))\n"
     + spc + "    throw std::system_error(WSAGetLastError(), std::system_category(), \"Error determining maximum MTU size\");\n"
+    "#else\n"
+    + spc + "  m_mtuMaxSize = 65507; //Largest UDP payload over IPv4\n"
+    "#endif\n"
     + spc + "}\n"
     + spc + "return m_mtuMaxSize;\n"
     "}\n");
@@ -308,32 +473,27 @@ std::string IoElement::generateFileIoHpp(const std::string& typeName)
 {
   std::string spc = Utils::getTabSpace();
   return std::string(
+    "#include \"Conversion.hpp\"\n\n"
     "//System includes:\n"
     "#include <fstream>\n"
     "#include <iostream>\n"
     "#include <memory>\n"
-    "#include <mutex>\n"
     "#include <string>\n"
     "#include <vector>\n\n"
     "class " + typeName + "\n"
     "{\n"
     "public:\n"
     + spc + "std::vector<uint8_t> m_data;\n"
-    + spc + "size_t m_offset;\n"
-    + spc + "std::mutex m_mutex;\n"
-
+    + spc + "size_t m_offset;\n\n"
     + spc + typeName + "() : m_data(), m_offset(0) {}\n"
     + spc + "void write(const uint8_t* pBuffer, size_t len, const std::string& filePath = std::string(), bool append = false);\n"
+    + spc + "/** Writes the slices back to back straight from where they are. */\n"
+    + spc + "void write(const IoSlice* pSlices, size_t count, const std::string& filePath = std::string(), bool append = false);\n"
     + spc + "bool read(uint8_t* pBuffer, size_t len, const std::string& filePath = std::string());\n"
     + spc + "bool read(const std::string& filePath = std::string());\n"
-    + spc + "void adjust(bool /* doAdjustment */) {} // Unneeded for file IO.\n\n"
-    + spc + "static std::shared_ptr<" + typeName + "> get()\n"
-    + spc + "{\n"
-    + spc + spc + "std::lock_guard<std::mutex> lock(m_mutex);\n"
-    + spc + spc + "static auto pInstance = std::make_shared<" + typeName + ">();\n"
-    + spc + spc + "return pInstance;\n"
-    + spc + "}\n"
-    "};\n\n");
+    + spc + "void adjust(bool /* doAdjustment */, size_t /* needed */ = 0) {} // Unneeded for file IO.\n\n"
+    + generateInstanceAccessors(typeName)
+    + "};\n\n");
 }
 
 std::string IoElement::generateFileIoCpp(const std::string& typeName)
@@ -343,6 +503,12 @@ std::string IoElement::generateFileIoCpp(const std::string& typeName)
     "#include <sys/stat.h>\n\n"
     "void " + typeName + "::write(const uint8_t* pBuffer, size_t len, const std::string& filePath, bool append)\n"
     "{\n"
+    + spc + "IoSlice slice = { pBuffer, len };\n"
+    + spc + "write(&slice, 1, filePath, append);\n"
+    "}\n\n"
+
+    "void " + typeName + "::write(const IoSlice* pSlices, size_t count, const std::string& filePath, bool append)\n"
+    "{\n"
     + spc + "std::string fPath(filePath);\n"
     + spc + "try\n"
     + spc + "{\n"
@@ -353,7 +519,8 @@ std::string IoElement::generateFileIoCpp(const std::string& typeName)
     + spc + spc + spc + "std::cout << std::endl;\n"
     + spc + spc + "}\n"
     + spc + spc + "std::ofstream ofs(fPath, (append ? std::ofstream::binary | std::ofstream::app : std::ofstream::binary));\n"
-    + spc + spc + "ofs.write(reinterpret_cast<const char*>(pBuffer), len);\n"
+    + spc + spc + "for(size_t i = 0; i < count; ++i)\n"
+    + spc + spc + spc + "ofs.write(reinterpret_cast<const char*>(pSlices[i].pData), pSlices[i].len);\n"
     + spc + spc + "ofs.flush();\n"
     + spc + spc + "ofs.close();\n"
     + spc + "}\n"
@@ -402,3 +569,116 @@ std::string IoElement::generateFileIoCpp(const std::string& typeName)
     + spc + "return read(&m_data[0], len, fPath);\n"
     "}\n\n");
 }
+
+std::string IoElement::generateColumnsIoHpp(const std::string& typeName)
+{
+  std::string spc = Utils::getTabSpace();
+  return std::string(
+    "#include \"Conversion.hpp\"\n\n"
+    "//System includes:\n"
+    "#include <cstdint>\n"
+    "#include <fstream>\n"
+    "#include <iostream>\n"
+    "#include <memory>\n"
+    "#include <string>\n"
+    "#include <vector>\n\n"
+    "/**\n"
+    " * Appends records to a columnar file that can be memory mapped and read\n"
+    " * without the wire format. All integers are in host byte order.\n"
+    " *\n"
+    " * Header:    \"TEBNFCOL\", uint32 version, uint32 column count, then per column\n"
+    " *            uint32 width, char type, uint8 name length and the name.\n"
+    " * Row group: uint64 row count, then each column's rows back to back.\n"
+    " * The header and every column are zero padded to a multiple of 8 bytes.\n"
+    " */\n"
+    "class " + typeName + "\n"
+    "{\n"
+    "public:\n"
+    + spc + "std::vector<uint8_t> m_data;\n"
+    + spc + "size_t m_offset;\n\n"
+    + spc + typeName + "(size_t rowGroupSize = 4096) : m_data(), m_offset(0), m_rowCount(0), m_rowGroupSize(rowGroupSize) {}\n"
+    + spc + "~" + typeName + "() { flush(); }\n"
+    + spc + "/** Buffers one record; a whole row group is written at once. */\n"
+    + spc + "template<typename Record>\n"
+    + spc + "void write(Record& rRecord)\n"
+    + spc + "{\n"
+    + spc + spc + "if(m_columns.empty())\n"
+    + spc + spc + spc + "open(Record::columnSchema());\n"
+    + spc + spc + "rRecord.appendRow(m_columns);\n"
+    + spc + spc + "if(++m_rowCount >= m_rowGroupSize)\n"
+    + spc + spc + spc + "flush();\n"
+    + spc + "}\n"
+    + spc + "/** Writes the buffered rows as one row group. */\n"
+    + spc + "void flush();\n"
+    + spc + "void adjust(bool /* doAdjustment */, size_t /* needed */ = 0) {} // Unneeded for columnar output.\n\n"
+    + generateInstanceAccessors(typeName)
+    + "private:\n"
+    + spc + "void open(const std::vector<ColumnSchema>& schema);\n"
+    + spc + "void pad(size_t len);\n"
+    + spc + "std::ofstream m_ofs;\n"
+    + spc + "std::vector<std::vector<uint8_t>> m_columns;\n"
+    + spc + "size_t m_rowCount;\n"
+    + spc + "size_t m_rowGroupSize;\n"
+    + "};\n\n");
+}
+
+std::string IoElement::generateColumnsIoCpp(const std::string& typeName)
+{
+  std::string spc = Utils::getTabSpace();
+  return std::string(
+    "#include <sys/stat.h>\n\n"
+    "void " + typeName + "::flush()\n"
+    "{\n"
+    + spc + "if(0 == m_rowCount)\n"
+    + spc + spc + "return;\n"
+    + spc + "uint64_t rowCount = m_rowCount;\n"
+    + spc + "m_ofs.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));\n"
+    + spc + "for(std::vector<uint8_t>& rColumn : m_columns)\n"
+    + spc + "{\n"
+    + spc + spc + "m_ofs.write(reinterpret_cast<const char*>(rColumn.data()), rColumn.size());\n"
+    + spc + spc + "pad(rColumn.size());\n"
+    + spc + spc + "rColumn.clear(); //Keeps capacity for the next row group\n"
+    + spc + "}\n"
+    + spc + "m_ofs.flush();\n"
+    + spc + "m_rowCount = 0;\n"
+    "}\n\n"
+
+    "void " + typeName + "::open(const std::vector<ColumnSchema>& schema)\n"
+    "{\n"
+    + spc + "std::string fPath;\n"
+    + spc + "std::cout << \"Write columnar file path : \";\n"
+    + spc + "std::cin >> fPath;\n"
+    + spc + "std::cout << std::endl;\n"
+    + spc + "//Rows are appended to an existing file, which must have the same schema.\n"
+    + spc + "struct stat st;\n"
+    + spc + "bool isNew = 0 != stat(fPath.c_str(), &st) || 0 == st.st_size;\n"
+    + spc + "m_ofs.open(fPath, std::ofstream::binary | std::ofstream::app);\n"
+    + spc + "if(!m_ofs)\n"
+    + spc + spc + "std::cerr << \"Error opening \" << fPath << std::endl;\n"
+    + spc + "m_columns.resize(schema.size());\n"
+    + spc + "for(size_t i = 0; i < schema.size(); ++i)\n"
+    + spc + spc + "m_columns[i].reserve(schema[i].width * m_rowGroupSize);\n"
+    + spc + "if(!isNew)\n"
+    + spc + spc + "return;\n"
+    + spc + "uint32_t header[] = { 1, static_cast<uint32_t>(schema.size()) };\n"
+    + spc + "size_t len = 8 + sizeof(header);\n"
+    + spc + "m_ofs.write(\"TEBNFCOL\", 8);\n"
+    + spc + "m_ofs.write(reinterpret_cast<const char*>(header), sizeof(header));\n"
+    + spc + "for(const ColumnSchema& column : schema)\n"
+    + spc + "{\n"
+    + spc + spc + "uint8_t nameLen = static_cast<uint8_t>(std::string(column.name).size());\n"
+    + spc + spc + "m_ofs.write(reinterpret_cast<const char*>(&column.width), sizeof(column.width));\n"
+    + spc + spc + "m_ofs.write(&column.type, 1);\n"
+    + spc + spc + "m_ofs.write(reinterpret_cast<const char*>(&nameLen), 1);\n"
+    + spc + spc + "m_ofs.write(column.name, nameLen);\n"
+    + spc + spc + "len += sizeof(column.width) + 2 + nameLen;\n"
+    + spc + "}\n"
+    + spc + "pad(len);\n"
+    "}\n\n"
+
+    "void " + typeName + "::pad(size_t len)\n"
+    "{\n"
+    + spc + "static const char s_zeros[8] = {};\n"
+    + spc + "m_ofs.write(s_zeros, (8 - len % 8) % 8);\n"
+    "}\n\n");
+}
@@ -25,10 +25,13 @@ public:
 
   static std::shared_ptr<SupportClass> generateWsaSessionHpp();
   static std::string generateUdpSocketHpp(const std::string& typeName);
-  static std::string generateUdpSocketCpp(const std::string& typeName);
+  static std::string generateUdpSocketCpp(const std::string& typeName, bool isInput);
 
   static std::string generateFileIoHpp(const std::string& typeName);
   static std::string generateFileIoCpp(const std::string& typeName);
+
+  static std::string generateColumnsIoHpp(const std::string& typeName);
+  static std::string generateColumnsIoCpp(const std::string& typeName);
 };
 
 #endif //IOELEMENT_HPP
\ No newline at end of file
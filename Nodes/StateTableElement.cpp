@@ -2,10 +2,17 @@
 #include "StateTableElement.hpp"
 
 #include "Elements.hpp"
+#include "Expression.hpp"
 #include "ScopedBlock.hpp"
+#include "../Generator.hpp"
+
+//System includes:
+#include <iomanip>
 
 namespace
 {
+  const std::string STATE_LABELS_PLACEHOLDER("/*state labels*/");
+
   std::string getInputReadFuncCall(SubElementState* pStateSubElement)
   {
     std::string inputReadFuncCall;
@@ -39,6 +46,9 @@ namespace
             }
           }
           break;
+        default:
+          //Outputs, COLUMNS among them, and unsupported inputs are not read.
+          break;
         };
       }
     }
@@ -53,6 +63,13 @@ namespace
       auto pSubElementActionLine = reinterpret_cast<SubElementActionLine*>(pNodeSubElementActionLine);
       auto rpnTokens = pSubElementActionLine->getRpnTokens();
       std::string condStr;
+      auto pExpr = Expression::parse(rpnTokens);
+      if(pExpr)
+      {
+        pExpr->simplify(nullptr);
+        condStr = pExpr->toCpp();
+        rpnTokens.clear();
+      }
       for(auto it = rpnTokens.begin(); it != rpnTokens.end(); ++it)
       {
         if(!condStr.empty())
@@ -79,6 +96,7 @@ namespace
       if(!nextStateCleanup.empty())
         block << nextStateCleanup;
     }
+    block << "isIdle = false;\n";
     if(pOutputOrAction)
     {
       if(!pOutputOrAction->getToken()->isSymbolActions() &&
@@ -107,6 +125,21 @@ namespace
             block << elementAccessor << "write(" << varName << ");\n";
           }
         }
+        else if(Types::ELEMENT_TYPE_IO_OUTPUT_COLUMNS == pOutputElement->getElementType())
+        {
+          //Columnar outputs take the decoded record rather than its wire bytes.
+          auto pGrammar = dynamic_cast<GrammarElement*>(pOutputOrAction.get());
+          if(pGrammar && pGrammar->isFixedLayout())
+          {
+            block << Utils::getElementAccessor(pOutputElement) << "write(*"
+                  << pGrammar->getCppTypeInfo()->getTypeNameStr() << "::get());\n";
+          }
+          else
+          {
+            Utils::Logger::logErr(pOutputOrAction->getToken(),
+              "Only grammars whose fields all have a static size can be written to a COLUMNS output");
+          }
+        }
         else
         {
           auto pOutputOrActionCppInfo = pOutputOrAction->getCppTypeInfo();
@@ -115,15 +148,370 @@ namespace
           {
             std::string elementAccessor = Utils::getElementAccessor(pOutputElement);
             std::string outputOrActionAccessor = Utils::getElementAccessor(*pOutputOrActionCppInfo);
-            block << "std::vector<uint8_t> marshalledData;\n";
-            block << pOutputOrActionCppInfo->getMarshalCall(outputOrActionAccessor, "marshalledData") + ";\n";
-            block << elementAccessor << "write(&marshalledData[0], marshalledData.size());\n";
+            auto pGrammar = dynamic_cast<GrammarElement*>(pOutputOrAction.get());
+            auto pIoElement = pOutputElement->isAsElement() ? pOutputElement->getChildren()->pChildElement : pOutputElement;
+            bool isGatherOutput = pIoElement &&
+              (Types::ELEMENT_TYPE_IO_OUTPUT_FILE == pIoElement->getElementType() ||
+               Types::ELEMENT_TYPE_IO_INPUT_FILE == pIoElement->getElementType() ||
+               Types::ELEMENT_TYPE_IO_OUTPUT_UDP_IP == pIoElement->getElementType() ||
+               Types::ELEMENT_TYPE_IO_INPUT_UDP_IP == pIoElement->getElementType());
+            if(pGrammar && isGatherOutput && pGrammar->canMarshalIov())
+            {
+              //Large fields go straight from the record to the output.
+              std::string grammarTypeName(pGrammar->getCppTypeInfo()->getTypeNameStr());
+              block << "IoSlice slices[" << grammarTypeName << "::iovMaxSlices];\n";
+              block << elementAccessor << "write(slices, " << outputOrActionAccessor << "marshalIov(slices));\n";
+            }
+            else
+            {
+              //The send buffer keeps its capacity, so steady state sends do not allocate.
+              if(pGrammar && pGrammar->canMarshalInto())
+              {
+                block << "m_sendBuffer.resize(" << outputOrActionAccessor << "wireSize());\n";
+                block << outputOrActionAccessor << "marshalInto(m_sendBuffer.data());\n";
+              }
+              else
+                block << pOutputOrActionCppInfo->getMarshalCall(outputOrActionAccessor, "m_sendBuffer") + ";\n";
+              block << elementAccessor << "write(m_sendBuffer.data(), m_sendBuffer.size());\n";
+            }
           }
         }
       }
     }
   }
 
+  //@return the grammar of a row whose fields nothing reads, or null.
+  GrammarElement* getMatchOnlyGrammar(SubElementState* pRow)
+  {
+    auto pGrammar = dynamic_cast<GrammarElement*>(pRow->getInputOrCondition().get());
+    return pGrammar && pGrammar->isMatchOnly() ? pGrammar : nullptr;
+  }
+
+  //@return the local a match-only grammar reports its record length in.
+  std::string getConsumedVarName(GrammarElement* pGrammar)
+  {
+    return pGrammar->getCppTypeInfo()->typeNameStr + "Consumed";
+  }
+
+  //Rows that only test whether input matches validate it, without decoding fields.
+  std::string getGrammarInputCall(SubElementState* pRow, const std::string& inputData)
+  {
+    auto pMatchGrammar = getMatchOnlyGrammar(pRow);
+    if(pMatchGrammar)
+      return pRow->getInputOrCondition()->getNodeAccessor() + "match(" + inputData + ", " + getConsumedVarName(pMatchGrammar) + ")";
+    return pRow->getInputOrCondition()->getNodeAccessor() + "unmarshal(" + inputData + ")";
+  }
+
+  //Declares the record length of each match-only grammar tried in a state.
+  void declareConsumedVars(ScopedBlock& block, StateTableElement* pStateTableElement, size_t firstRow)
+  {
+    auto& rRows = pStateTableElement->getChildren()->children;
+    for(size_t j = firstRow; j < rRows.size(); j++)
+    {
+      auto pRow = reinterpret_cast<SubElementState*>(rRows.at(j).get());
+      if(j > firstRow && std::string::npos == pRow->getState().find("else"))
+        break;
+      auto pMatchGrammar = getMatchOnlyGrammar(pRow);
+      if(pMatchGrammar)
+        block << "size_t " << getConsumedVarName(pMatchGrammar) << " = 0;\n";
+    }
+  }
+
+  //@return true if pNode is pElement itself, reads one of its members or is
+  //  an ACTIONS element with a line that does.
+  bool isNodeAccessingElement(Node* pNode, Element* pElement)
+  {
+    if(!pNode)
+      return false;
+    const std::string& elementName = pElement->getName();
+    auto isAccessTok = [&](std::shared_ptr<Token> pTok)->bool
+    { return pTok->pAccessedElementToken && elementName == pTok->pAccessedElementToken->text; };
+    if(pNode->isType("SubElementActionLine"))
+    {
+      auto rpnTokens = reinterpret_cast<SubElementActionLine*>(pNode)->getRpnTokens();
+      return std::any_of(rpnTokens.begin(), rpnTokens.end(), isAccessTok);
+    }
+    if(pNode->isType("ActionsElement"))
+    {
+      for(std::shared_ptr<SubElement> pSe : pNode->getChildren()->children)
+      {
+        if(isNodeAccessingElement(pSe.get(), pElement))
+          return true;
+      }
+      return false;
+    }
+    //Element tokens hold the element keyword, e.g. GRAMMAR, not its name.
+    if(pNode->isElement())
+      return pElement == pNode;
+    return isAccessTok(pNode->getToken());
+  }
+
+  //Borrowed grammar fields point into the input element's buffer, which is
+  //read into again by later states, so copy them if other rows use them.
+  void materializeIfReadLater(
+    ScopedBlock& block,
+    StateTableElement* pStateTableElement,
+    SubElementState* pStateSubElement)
+  {
+    auto pGrammar = pStateSubElement->getInputOrCondition();
+    if(!pGrammar || !pGrammar->isType("GrammarElement"))
+      return;
+    Element* pGrammarElement = dynamic_cast<Element*>(pGrammar.get());
+    for(std::shared_ptr<SubElement> pSe : pStateTableElement->getChildren()->children)
+    {
+      auto pRow = reinterpret_cast<SubElementState*>(pSe.get());
+      if(pRow == pStateSubElement)
+        continue;
+      auto pInputOrCond = pRow->getInputOrCondition();
+      if((pInputOrCond && !pInputOrCond->isType("GrammarElement") && isNodeAccessingElement(pInputOrCond.get(), pGrammarElement)) ||
+         isNodeAccessingElement(pRow->getOutputOrAction().get(), pGrammarElement))
+      {
+        block << pGrammar->getNodeAccessor() << "materialize(); // Used after the input buffer changes\n";
+        return;
+      }
+    }
+  }
+
+  //Emits a switch on the first input byte when the grammars tried in a state
+  //start with different literals, so only the one that can match is tried.
+  //@return false if any first byte is unknown or shared, or an else row
+  //  needs the ordered attempts.
+  bool generateFirstByteDispatch(
+    std::stringstream& line,
+    StateTableElement* pStateTableElement,
+    size_t& i,
+    size_t& tabCount)
+  {
+    auto& rRows = pStateTableElement->getChildren()->children;
+    std::vector<SubElementState*> chainRows(1, reinterpret_cast<SubElementState*>(rRows.at(i).get()));
+    for(size_t j = (i + 1); j < rRows.size(); j++)
+    {
+      auto pRow = reinterpret_cast<SubElementState*>(rRows.at(j).get());
+      if(std::string::npos != pRow->getState().find("else_if"))
+        chainRows.push_back(pRow);
+      else if(std::string::npos != pRow->getState().find("else"))
+        return false;
+      else
+        break;
+    }
+    if(chainRows.size() < 2)
+      return false;
+    std::set<uint8_t> seenBytes;
+    std::vector<std::set<uint8_t> > rowFirstBytes;
+    for(SubElementState* pRow : chainRows)
+    {
+      auto pGrammar = pRow->getInputOrCondition();
+      std::set<uint8_t> firstBytes;
+      if(!pGrammar || !pGrammar->isType("GrammarElement") ||
+         !reinterpret_cast<GrammarElement*>(pGrammar.get())->getFirstBytes(firstBytes))
+        return false;
+      for(uint8_t firstByte : firstBytes)
+      {
+        if(!seenBytes.insert(firstByte).second)
+          return false;
+      }
+      rowFirstBytes.push_back(firstBytes);
+    }
+    std::string inputData(chainRows.front()->getInputElement()->getNodeAccessor() + "m_data");
+    {
+      ScopedBlock switchBlock(line, tabCount, "switch(" + inputData + ".empty() ? -1 : " + inputData + "[0])");
+      for(size_t k = 0; k < chainRows.size(); k++)
+      {
+        for(uint8_t firstByte : rowFirstBytes.at(k))
+        {
+          std::stringstream caseLabel;
+          caseLabel << "case 0x" << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+                    << static_cast<int>(firstByte) << ":\n";
+          switchBlock << caseLabel.str();
+        }
+        tabCount++;
+        {
+          ScopedBlock rowBlock(line, tabCount, "if(" + getGrammarInputCall(chainRows.at(k), inputData) + ")");
+          materializeIfReadLater(rowBlock, pStateTableElement, chainRows.at(k));
+          generateNextStateAndOutput(rowBlock, chainRows.at(k));
+        }
+        switchBlock << "break;\n";
+        tabCount--;
+      }
+      switchBlock << "default:\n";
+      tabCount++;
+      switchBlock << "break;\n";
+      tabCount--;
+    }
+    i += chainRows.size() - 1;
+    return true;
+  }
+
+  //@return the state table member that keeps a shard's instance of an element, e.g. m_pTape.
+  std::string getShardInstanceMember(const std::string& instanceTypeName)
+  {
+    std::string member("m_p" + instanceTypeName);
+    member[3] = static_cast<char>(std::toupper(static_cast<unsigned char>(member[3])));
+    return member;
+  }
+
+  //@return true if a row's condition compares a field, or an item of a range field, whose C++ type
+  //  is an integer with a literal, e.g. @tape.elements[@tape.$i] == '1'. rLhs gets the field and
+  //  rLiteral and rValue the literal.
+  bool getCaseCondition(
+    SubElementState* pRow,
+    std::string& rLhs,
+    std::string& rLiteral,
+    long long& rValue)
+  {
+    auto pCond = pRow->getInputOrCondition();
+    if(!pCond || !pCond->isType("SubElementActionLine"))
+      return false;
+    auto tokens = reinterpret_cast<SubElementActionLine*>(pCond.get())->getRpnTokens();
+    //The field is one operand, optionally followed by one subscript.
+    if(tokens.size() < 3 || "==" != tokens.at(tokens.size() - 2)->text || tokens.front()->isStaticVariable())
+      return false;
+    std::vector<std::shared_ptr<Token> > lhsTokens(tokens.begin(), tokens.end() - 2);
+    bool isIndexed = lhsTokens.size() > 1;
+    if(isIndexed && (lhsTokens.size() < 4 || "[" != lhsTokens.at(1)->text || "]" != lhsTokens.back()->text))
+      return false;
+    auto pField = Elements::findSubElement(lhsTokens.front());
+    auto pInfo = pField ? pField->getCppTypeInfo() : nullptr;
+    if(!pInfo || pInfo->isBitset() || pInfo->isNumStr ||
+       (isIndexed ? !pInfo->isVector() && !pInfo->isString() : pInfo->isVector() || pInfo->isString()))
+      return false;
+    if(!pInfo->isString() && std::string::npos == pInfo->typeStr.find("int") && "char" != pInfo->typeStr)
+      return false;
+    //Only plain character literals and whole numbers make case labels.
+    rLiteral = tokens.back()->text;
+    if(3 == rLiteral.size() && '\'' == rLiteral.front() && '\'' == rLiteral.back() && '\\' != rLiteral[1])
+      rValue = static_cast<unsigned char>(rLiteral[1]);
+    else if(!rLiteral.empty() && std::isdigit(static_cast<unsigned char>(rLiteral.front())))
+    {
+      size_t length = 0;
+      rValue = std::stoll(rLiteral, &length, 0);
+      if(rLiteral.size() != length)
+        return false;
+    }
+    else
+      return false;
+    auto pLhs = Expression::parse(lhsTokens);
+    if(!pLhs)
+      return false;
+    pLhs->simplify(nullptr);
+    rLhs = pLhs->toCpp();
+    return true;
+  }
+
+  //Emits a state whose rows all compare the same field with different literals as one
+  //switch, so the field is read once and the compiler can jump through a table.
+  //@return false if the rows are not of that form.
+  bool generateConditionSwitch(
+    std::stringstream& line,
+    StateTableElement* pStateTableElement,
+    size_t& i,
+    size_t& tabCount)
+  {
+    auto& rRows = pStateTableElement->getChildren()->children;
+    auto pFirstRow = reinterpret_cast<SubElementState*>(rRows.at(i).get());
+    std::vector<SubElementState*> caseRows(1, pFirstRow);
+    SubElementState* pDefaultRow = nullptr;
+    for(size_t j = (i + 1); j < rRows.size() && !pDefaultRow; j++)
+    {
+      auto pRow = reinterpret_cast<SubElementState*>(rRows.at(j).get());
+      if(0 != pRow->getState().find(pFirstRow->getState() + "_else"))
+        break;
+      if(std::string::npos != pRow->getState().find("else_if"))
+        caseRows.push_back(pRow);
+      else
+        pDefaultRow = pRow;
+    }
+    if(caseRows.size() < 2)
+      return false;
+    std::string lhs;
+    std::vector<std::string> literals;
+    std::set<long long> values;
+    for(SubElementState* pRow : caseRows)
+    {
+      std::string rowLhs;
+      std::string literal;
+      long long value = 0;
+      if(!getCaseCondition(pRow, rowLhs, literal, value) ||
+         (!lhs.empty() && rowLhs != lhs) || !values.insert(value).second)
+        return false;
+      lhs = rowLhs;
+      literals.push_back(literal);
+    }
+    {
+      ScopedBlock switchBlock(line, tabCount, "switch(" + lhs + ")");
+      for(size_t k = 0; k < caseRows.size(); k++)
+      {
+        switchBlock << "case " << literals.at(k) << ":\n";
+        tabCount++;
+        {
+          ScopedBlock rowBlock(line, tabCount);
+          materializeIfReadLater(rowBlock, pStateTableElement, caseRows.at(k));
+          generateNextStateAndOutput(rowBlock, caseRows.at(k));
+        }
+        switchBlock << "break;\n";
+        tabCount--;
+      }
+      switchBlock << "default:\n";
+      tabCount++;
+      if(pDefaultRow)
+      {
+        ScopedBlock rowBlock(line, tabCount);
+        materializeIfReadLater(rowBlock, pStateTableElement, pDefaultRow);
+        generateNextStateAndOutput(rowBlock, pDefaultRow);
+      }
+      switchBlock << "break;\n";
+      tabCount--;
+    }
+    i += caseRows.size() - (pDefaultRow ? 0 : 1);
+    return true;
+  }
+
+  //Grow the input buffer while staying in the state, sized by what the grammars
+  //still need, and start the grammars over once the state is left.
+  void generateInputAdjust(
+    std::stringstream& line,
+    ScopedBlock& block,
+    StateTableElement* pStateTableElement,
+    SubElementState* pStateSubElement,
+    size_t firstRow,
+    size_t lastRow,
+    size_t& tabCount)
+  {
+    std::string inputData(pStateSubElement->getInputElement()->getNodeAccessor() + "m_data");
+    std::vector<std::string> grammarAccessors, grammarNeeds;
+    for(size_t j = firstRow; j <= lastRow; j++)
+    {
+      auto pRow = reinterpret_cast<SubElementState*>(pStateTableElement->getChildren()->getChild(j).get());
+      auto pGrammar = pRow->getInputOrCondition();
+      auto pMatchGrammar = getMatchOnlyGrammar(pRow);
+      if(pMatchGrammar)
+      {
+        //match() reports a record length past the end of short data.
+        std::string consumed(getConsumedVarName(pMatchGrammar));
+        grammarNeeds.push_back("Conversion::shortfall(" + consumed + ", " + inputData + ".size())");
+      }
+      else if(pGrammar && pGrammar->isType("GrammarElement"))
+      {
+        grammarAccessors.push_back(pGrammar->getNodeAccessor());
+        grammarNeeds.push_back(pGrammar->getNodeAccessor() + "needed()");
+      }
+    }
+    std::string needed(grammarNeeds.empty() ? "0" : grammarNeeds.front());
+    if(grammarNeeds.size() > 1)
+    {
+      //Several grammars were tried, so the input keeps room for the longest wait.
+      block << "size_t needed = " << grammarNeeds.front() << ";\n";
+      for(size_t j = 1; j < grammarNeeds.size(); j++)
+        block << "needed = std::max(needed, " << grammarNeeds.at(j) << ");\n";
+      needed = "needed";
+    }
+    std::string enumStateName("STATES_" + pStateSubElement->getState());
+    block << pStateSubElement->getInputElement()->getNodeAccessor() << "adjust(" << enumStateName << " == m_state, " << needed << ");\n";
+    ScopedBlock restartBlock(line, tabCount, "if(" + enumStateName + " != m_state)");
+    for(const std::string& accessor : grammarAccessors)
+      restartBlock << accessor << "restart();\n";
+  }
+
   void generateInputOrCondElseIfBlocks(
     std::stringstream& line,
     const std::string& inputOrCondBeginBlockStr,
@@ -137,6 +525,7 @@ namespace
     //Input or condition if-block
     {
       ScopedBlock inputOrCondBlock(line, tabCount, inputOrCondBeginBlockStr);
+      materializeIfReadLater(inputOrCondBlock, pStateTableElement, pStateSubElement);
       generateNextStateAndOutput(inputOrCondBlock, pStateSubElement);
     }
     //Input or condition else-if block(s)
@@ -148,7 +537,7 @@ namespace
       {
         if(pInputOrCond && pInputOrCond->isType("GrammarElement"))
         {
-          beginBlockString.assign("else if(" + pElseIfStateChild->getInputOrCondition()->getNodeAccessor() + "unmarshal(" + pInputElement->getNodeAccessor() + "m_data))");
+          beginBlockString.assign("else if(" + getGrammarInputCall(pElseIfStateChild, pInputElement->getNodeAccessor() + "m_data") + ")");
         }
         else if(pElseIfStateChild->getInputOrCondition())
         {
@@ -165,33 +554,84 @@ namespace
       else
         break;
       ScopedBlock inputOrCondElseBlock(line, tabCount, beginBlockString);
+      materializeIfReadLater(inputOrCondElseBlock, pStateTableElement, pElseIfStateChild);
       generateNextStateAndOutput(inputOrCondElseBlock, pElseIfStateChild);
       i++;
     }
   }
 
+  //@return the text of a row cell, so rows can be compared.
+  std::string getNodeSignature(Node* pNode)
+  {
+    if(!pNode)
+      return std::string();
+    std::string signature;
+    auto appendToken = [&](std::shared_ptr<Token> pTok)
+    {
+      if(pTok->pAccessedElementToken)
+        signature += pTok->pAccessedElementToken->text + ".";
+      signature += pTok->text + " ";
+    };
+    if(pNode->isType("SubElementActionLine"))
+    {
+      for(std::shared_ptr<Token> pTok : reinterpret_cast<SubElementActionLine*>(pNode)->getRpnTokens())
+        appendToken(pTok);
+    }
+    else
+    {
+      appendToken(pNode->getToken());
+      //Calls to the same actions with other arguments do different things.
+      if(pNode->isType("ActionsElement"))
+      {
+        signature += "( ";
+        for(std::shared_ptr<Token> pTok : reinterpret_cast<ActionsElement*>(pNode)->getArgs())
+          appendToken(pTok);
+        signature += ") ";
+      }
+    }
+    return signature;
+  }
+
+  //@return everything about a row but its next state.
+  std::string getRowSignature(const std::string& state, SubElementState* pRow)
+  {
+    auto pInputElement = pRow->getInputElement();
+    auto pOutputElement = pRow->getOutputElement();
+    //Else rows are named after their state, so only the kind of row is compared.
+    std::string kind(pRow->getState() == state ? "" :
+      std::string::npos != pRow->getState().find("else_if") ? "else if" : "else");
+    return kind + "|" +
+      getNodeSignature(pRow->getInputOrCondition().get()) + "|" +
+      getNodeSignature(pRow->getInputMethod().get()) + "|" +
+      (pInputElement ? pInputElement->getName() : std::string()) + "|" +
+      getNodeSignature(pRow->getOutputOrAction().get()) + "|" +
+      (pOutputElement ? pOutputElement->getName() : std::string()) + "\n";
+  }
+
   void clearDataBuffers(ScopedBlock& block, StateTableElement* pElem)
   {
     std::set<std::string> ioElements;
+    bool isAnyCleared = false;
+    auto clearDataBuffer = [&](std::shared_ptr<Element> pIoElement, bool isInput)
+    {
+      if(!pIoElement || !ioElements.insert(pIoElement->getName()).second)
+        return;
+      //UDP inputs size their buffer on each read and may still hold the start
+      //of a record that continues in the next datagram.
+      auto pTypeElement = pIoElement->isAsElement() ? pIoElement->getChildren()->pChildElement : pIoElement;
+      if(isInput && pTypeElement && Types::ELEMENT_TYPE_IO_INPUT_UDP_IP == pTypeElement->getElementType())
+        return;
+      if(!isAnyCleared) block << "// Clear IO data buffers in first state\n";
+      block << pIoElement->getNodeAccessor() << "m_data.clear();\n";
+      isAnyCleared = true;
+    };
     for(std::shared_ptr<SubElement> pSe : pElem->getChildren()->children)
     {
       auto pStateSubElement = reinterpret_cast<SubElementState*>(pSe.get());
-      auto pInputElement = pStateSubElement->getInputElement();
-      auto pOutputElement = pStateSubElement->getOutputElement();
-      if(pInputElement && ioElements.end() == ioElements.find(pInputElement->getName()))
-      {
-        if(ioElements.empty()) block << "// Clear IO data buffers in first state\n";
-        ioElements.insert(pInputElement->getName());
-        block << pInputElement->getNodeAccessor() << "m_data.clear();\n";
-      }
-      if(pOutputElement && ioElements.end() == ioElements.find(pOutputElement->getName()))
-      {
-        if(ioElements.empty()) block << "// Clear IO data buffers in first state\n";
-        ioElements.insert(pOutputElement->getName());
-        block << pOutputElement->getNodeAccessor() << "m_data.clear();\n";
-      }
+      clearDataBuffer(pStateSubElement->getInputElement(), true);
+      clearDataBuffer(pStateSubElement->getOutputElement(), false);
     }
-    if(!ioElements.empty())
+    if(isAnyCleared)
       block << "\n";
   }
 } // End anonymous namespace
@@ -206,6 +646,7 @@ void StateTableElement::generateCode()
 {
   if(!getCppTypeInfo())
     setCppTypeInfo(std::make_shared<CppTypeInfo>());
+  minimizeStates();
   std::string spaces = Utils::getTabSpace(1);
   //hpp includes
   getCppTypeInfo()->hppIncludes.push_back("#include <atomic>\n");
@@ -214,49 +655,156 @@ void StateTableElement::generateCode()
   getCppTypeInfo()->hppIncludes.push_back("#include <vector>\n");
   //Declare struct/class in hpp.
   std::string typeName(getCppTypeInfo()->typeNameStr);
-  getCppTypeInfo()->hppStatements.push_back("\nclass " + typeName + "\n");
+  if(Generator::isSessionScheduled())
+  {
+    getCppTypeInfo()->hppIncludes.push_back("#include \"SessionScheduler.hpp\"\n");
+    getCppTypeInfo()->hppStatements.push_back("\nclass " + typeName + " : public Session\n");
+  }
+  else
+    getCppTypeInfo()->hppStatements.push_back("\nclass " + typeName + "\n");
   getCppTypeInfo()->hppStatements.push_back("{\n");
   getCppTypeInfo()->hppStatements.push_back("public:\n");
-  getCppTypeInfo()->hppStatements.push_back(spaces + typeName + "();\n");
+  if(Generator::isSharded())
+  {
+    getCppTypeInfo()->hppStatements.push_back(spaces + "/** Runs one shard, which reads and writes its own element instances. */\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "explicit " + typeName + "(size_t shard = 0);\n");
+  }
+  else
+    getCppTypeInfo()->hppStatements.push_back(spaces + typeName + "();\n");
   getCppTypeInfo()->hppStatements.push_back(spaces + "~" + typeName + "();\n");
-  getCppTypeInfo()->hppStatements.push_back(spaces + "void doWork();\n");
+  if(Generator::isSessionScheduled())
+  {
+    getCppTypeInfo()->hppStatements.push_back(spaces + "/** Runs states on the calling scheduler thread until one has to wait. */\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "Status resume();\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "void attach(int epollFd);\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "void detach();\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "void notify(uint64_t event);\n");
+  }
+  else
+    getCppTypeInfo()->hppStatements.push_back(spaces + "void doWork();\n");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "/** Ends the state machine, waking it if it waits for input. */\n");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "void stop();\n");
   //cpp includes
+  getCppTypeInfo()->cppIncludes.push_back("#include <algorithm>\n");
   getCppTypeInfo()->cppIncludes.push_back("#include <chrono>\n");
+  getCppTypeInfo()->cppIncludes.push_back("#include <iostream>\n");
+  getCppTypeInfo()->cppIncludes.push_back(
+    "#if defined(__linux__)\n"
+    "#include <cerrno>\n"
+    "#include <system_error>\n"
+    "#include <sys/epoll.h>\n"
+    "#include <sys/eventfd.h>\n"
+    "#include <sys/timerfd.h>\n"
+    "#include <unistd.h>\n"
+    "#endif\n");
   getCppTypeInfo()->cppIncludes.push_back("#include \"" + typeName + ".hpp\"\n");
+  getCppTypeInfo()->cppIncludes.push_back("#include \"RuntimeConfig.hpp\"\n");
+  getCppTypeInfo()->cppIncludes.push_back(
+    "\n//Define STATE_TABLE_COMPUTED_GOTO to enter the current state through a table of label addresses\n"
+    "//(GCC and Clang) instead of the switch. Each call still runs one state and returns, so it is\n"
+    "//one indirect jump per call, like the switch's own jump table, not threaded dispatch.\n"
+    "#if defined(STATE_TABLE_COMPUTED_GOTO) && !defined(__GNUC__)\n"
+    "#undef STATE_TABLE_COMPUTED_GOTO\n"
+    "#endif\n"
+    "#if defined(STATE_TABLE_COMPUTED_GOTO)\n"
+    "#define STATE_LABEL(state) state_##state:\n"
+    "#else\n"
+    "#define STATE_LABEL(state)\n"
+    "#endif\n");
   std::vector<std::string> states;
+  std::vector<std::string> stateEvents;
   std::string firstState(getChildren()->getChild(0)->getToken()->text);
   std::stringstream line;
   line << "\n";
   size_t tabCount = 0;
   checkRequiresWsaSession();
+  findEventInputs();
   //Generate constructor
   {
     auto initListSpaces = Utils::getTabSpace(1);
-    ScopedBlock ctor(line, tabCount, typeName + "::" + typeName + "()\n"
-      ": " + "m_state(STATES_" + firstState + "),\n"
+    ScopedBlock ctor(line, tabCount, typeName + "::" + typeName + (Generator::isSharded() ? "(size_t shard)\n" : "()\n")
+      + ": " + "m_state(STATES_" + firstState + "),\n"
       + initListSpaces + "m_isRunning(true),\n"
-      + initListSpaces + "m_pWorkerThread()\n", 2);
-    ctor << "m_pWorkerThread = std::make_shared<std::thread>(&" << typeName << "::doWork, this);\n";
+      + initListSpaces + "m_sendBuffer(),\n"
+      + (Generator::isSharded() ? initListSpaces + "m_shard(shard),\n" : "")
+      + (Generator::isSessionScheduled()
+        ? initListSpaces + "m_isIdle(false),\n" + initListSpaces + "m_isTick(false),\n" + initListSpaces + "m_isTickWait(false)\n"
+        : initListSpaces + "m_pWorkerThread()\n"), 2);
+    generateInstanceCreation(ctor);
+    line << "#if defined(__linux__)\n";
+    if(Generator::isSessionScheduled())
+    {
+      //A session waits in the epoll of the scheduler thread it runs on, see attach().
+      ctor << "m_epollFd = -1;\n";
+      ctor << "m_readyInputs = 0;\n";
+    }
+    else
+      ctor << "createEvents();\n";
+    line << "#endif\n";
+    //Sessions leave their receive buffers to grow on the first reads, since most of them wait.
+    if(!Generator::isSessionScheduled())
+      ctor << "m_pWorkerThread = std::make_shared<std::thread>(&" << typeName << "::doWork, this);\n";
   }
   //Generate destructor
   {
     ScopedBlock dtor(line, tabCount, typeName + "::~" + typeName + "()", 2);
-    dtor << "m_pWorkerThread->join();\n";
+    if(!Generator::isSessionScheduled())
+    {
+      dtor << "m_pWorkerThread->join();\n";
+      line << "#if defined(__linux__)\n";
+      dtor << "close(m_tickFd);\n";
+      dtor << "close(m_stopFd);\n";
+      dtor << "close(m_epollFd);\n";
+      line << "#endif\n";
+    }
   }
-  //Generate worker thread's doWork function
+  //Generate worker thread's doWork function, or the resume function of a session
+  if(Generator::isSessionScheduled())
+  {
+    ScopedBlock resumeFunc(line, tabCount, "Session::Status " + typeName + "::resume()", 2);
+    generateInstanceSelection(resumeFunc);
+    resumeFunc << "//A few states at a time, so the other sessions of the worker run too\n";
+    {
+      ScopedBlock passBlock(line, tabCount, "for(size_t pass = 0; pass < 64; pass++)");
+      passBlock << "if(!waitForState(m_isIdle, 0))\n";
+      passBlock << spaces << "return !m_isRunning ? SESSION_STOPPED : m_isTickWait ? SESSION_TICK : SESSION_WAITING;\n";
+      passBlock << "m_isIdle = !runState();\n";
+    }
+    resumeFunc << "return m_isRunning ? SESSION_RUNNABLE : SESSION_STOPPED;\n";
+  }
+  else
   {
     ScopedBlock doWorkFunc(line, tabCount, "void " + typeName + "::doWork()", 2);
-    if(checkRequiresWsaSession())
-      doWorkFunc << "WSASession session; //For socket\n";
-    doWorkFunc << "m_isRunning = true;\n";
+    generateInstanceSelection(doWorkFunc);
+    doWorkFunc << "RuntimeConfig::get().applyThreadSettings(\"" << typeName << "\", " << (Generator::isSharded() ? "m_shard" : "0") << ");\n";
+    generatePrefault(doWorkFunc);
+    doWorkFunc << "bool isIdle = false; //No row ran in the last pass\n";
     doWorkFunc << "// Main state table thread loop\n";
+    ScopedBlock whileRunningBlock(line, tabCount, "while(m_isRunning)");
+    whileRunningBlock << "//Run a state once its input is readable, or after a tick if it found nothing to do\n";
+    whileRunningBlock << "if(!waitForState(isIdle, -1))\n";
+    whileRunningBlock << spaces << "break;\n";
+    whileRunningBlock << "isIdle = !runState();\n";
+  }
+  //Generate runState function, which runs the current state once
+  {
+    ScopedBlock runStateFunc(line, tabCount, "bool " + typeName + "::runState()", 2);
+    runStateFunc << "bool isIdle = true; //Cleared when a row runs\n";
 
     bool isFirst = true;
     bool isInputOrCondElseIf = false;
     size_t i = 0;
-    //While running loop block
+    //Errors the elements raise while running a state are reported here, and the loop keeps running.
     {
-      ScopedBlock whileRunningBlock(line, tabCount, "while(m_isRunning)");
+      ScopedBlock tryBlock(line, tabCount, "try");
+      //A switch jumps to the current state through a table, where a chain of ifs tested each state.
+      //Computed goto replaces only that one jump; every state still ends by leaving the switch.
+      line << "#if defined(STATE_TABLE_COMPUTED_GOTO)\n";
+      //The states are known once they are all generated, so the table is filled in then.
+      tryBlock << "static void* const stateLabels[] = { " << STATE_LABELS_PLACEHOLDER << " };\n";
+      tryBlock << "goto *stateLabels[m_state];\n";
+      line << "#endif\n";
+      ScopedBlock switchBlock(line, tabCount, "switch(m_state)");
       while(i < getChildren()->children.size())
       {
         auto pStateSubElement = reinterpret_cast<SubElementState*>(getChildren()->getChild(i).get());
@@ -265,10 +813,13 @@ void StateTableElement::generateCode()
         auto pOutputElement = pStateSubElement->getOutputElement();
         
         states.push_back(pStateSubElement->getState()); //Remember states for hpp enumeration declaration.
+        stateEvents.push_back(getStateEvent(pStateSubElement));
+        std::string enumStateName("STATES_" + pStateSubElement->getState());
+        switchBlock << "case " << enumStateName << ": STATE_LABEL(" << pStateSubElement->getState() << ")\n";
+        tabCount++;
         //State block
         {
-          std::string enumStateName("STATES_" + pStateSubElement->getState());
-          ScopedBlock stateBlock(line, tabCount, "if(" + enumStateName + " == m_state)");
+          ScopedBlock stateBlock(line, tabCount);
           //IO data buffers cleanup code
           if(isFirst)
           {
@@ -279,10 +830,19 @@ void StateTableElement::generateCode()
           if(pInputElement && pInputOrCond && pInputOrCond->isType("GrammarElement"))
           {
             ScopedBlock inputMethodBlock(line, tabCount, getInputReadFuncCall(pStateSubElement));
-            std::string ifCondStr("if(" + pInputOrCond->getNodeAccessor() + "unmarshal(" + pInputElement->getNodeAccessor() + "m_data))");
-            generateInputOrCondElseIfBlocks(line, ifCondStr, this, pStateSubElement, i, tabCount);
+            size_t firstRow = i;
+            declareConsumedVars(inputMethodBlock, this, firstRow);
+            if(!generateFirstByteDispatch(line, this, i, tabCount))
+            {
+              std::string ifCondStr("if(" + getGrammarInputCall(pStateSubElement, pInputElement->getNodeAccessor() + "m_data") + ")");
+              generateInputOrCondElseIfBlocks(line, ifCondStr, this, pStateSubElement, i, tabCount);
+            }
             // Adjust IO buffer if not moving to next state.
-            inputMethodBlock << pInputElement->getNodeAccessor() << "adjust(" + enumStateName + " == m_state);\n";
+            generateInputAdjust(line, inputMethodBlock, this, pStateSubElement, firstRow, i, tabCount);
+          }
+          else if(pInputOrCond && generateConditionSwitch(line, this, i, tabCount))
+          {
+            //Rows compare one field with literals
           }
           else if(pInputOrCond)
           {
@@ -299,14 +859,32 @@ void StateTableElement::generateCode()
             generateNextStateAndOutput(stateBlock, pStateSubElement);
           }
         } // end state block
+        switchBlock << "break;\n";
+        tabCount--;
         i++;
       }
-      whileRunningBlock << "//Yield CPU\n";
-      whileRunningBlock << "std::chrono::milliseconds ms(0);\n";
-      whileRunningBlock << "std::this_thread::sleep_for(ms);\n";
-    } //End of generated While(m_isRunning)
-  }//End of generated doWork function
-  getCppTypeInfo()->cppStatements.push_back(line.str());
+      switchBlock << "default: STATE_LABEL(NONE)\n";
+      tabCount++;
+      switchBlock << "break;\n";
+      tabCount--;
+    }
+    {
+      ScopedBlock catchBlock(line, tabCount, "catch(const std::exception& ex)");
+      catchBlock << "std::cerr << \"An error occurred in runState(): \" << std::string(ex.what()) << std::endl;\n";
+    }
+    {
+      ScopedBlock catchBlock(line, tabCount, "catch(...)");
+      catchBlock << "std::cerr << \"An unknown error occurred in runState()\" << std::endl;\n";
+    }
+    runStateFunc << "return !isIdle;\n";
+  }//End of generated runState function
+  generateEventFunctions(line, tabCount, stateEvents);
+  std::string stateLabels("&&state_NONE");
+  for(const std::string& state : states)
+    stateLabels += ", &&state_" + state;
+  std::string code(line.str());
+  code.replace(code.find(STATE_LABELS_PLACEHOLDER), STATE_LABELS_PLACEHOLDER.size(), stateLabels);
+  getCppTypeInfo()->cppStatements.push_back(code);
   line.clear();
 
   getCppTypeInfo()->hppStatements.push_back("private:\n");
@@ -322,12 +900,489 @@ void StateTableElement::generateCode()
     getCppTypeInfo()->hppStatements.push_back(spaces + "} m_state;\n");
   }
   getCppTypeInfo()->hppStatements.push_back(spaces + "std::atomic<bool> m_isRunning;\n");
-  getCppTypeInfo()->hppStatements.push_back(spaces + "std::shared_ptr<std::thread> m_pWorkerThread;");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "std::vector<uint8_t> m_sendBuffer; //Reused by every output\n");
+  if(Generator::isSharded())
+    getCppTypeInfo()->hppStatements.push_back(spaces + "size_t m_shard;\n");
+  if(Generator::isSessionScheduled())
+  {
+    getCppTypeInfo()->hppStatements.push_back(spaces + "bool m_isIdle; //No row ran in the last pass\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "bool m_isTick; //The scheduler's tick came since the last condition state ran\n");
+    getCppTypeInfo()->hppStatements.push_back(spaces + "bool m_isTickWait; //The current state waits for the next tick\n");
+  }
+  else
+    getCppTypeInfo()->hppStatements.push_back(spaces + "std::shared_ptr<std::thread> m_pWorkerThread;\n");
+  if(Generator::isSharded())
+  {
+    for(const std::string& instanceTypeName : m_instanceTypeNames)
+    {
+      getCppTypeInfo()->hppIncludes.push_back("class " + instanceTypeName + ";\n");
+      getCppTypeInfo()->hppStatements.push_back(
+        spaces + instanceTypeName + "* " + getShardInstanceMember(instanceTypeName) + "; //This shard's instance\n");
+    }
+  }
+  getCppTypeInfo()->hppStatements.push_back(spaces + "/** @return true once the current state can run, false if stopped or after timeout ms, -1 to wait on. */\n");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "bool waitForState(bool isIdle, int timeout);\n");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "/** Runs the current state once. @return true if one of its rows ran. */\n");
+  getCppTypeInfo()->hppStatements.push_back(spaces + "bool runState();\n");
+  if(Generator::isSessionScheduled())
+    getCppTypeInfo()->hppStatements.push_back(
+      "#if defined(__linux__)\n"
+      + spaces + "void watchEvent(int fd, uint64_t event, int operation);\n"
+      + spaces + "int m_epollFd; //The scheduler thread's, which the inputs are registered in\n"
+      + spaces + "uint64_t m_readyInputs; //Inputs reported readable that their state has not read yet\n"
+      + spaces + "std::vector<int> m_inputFds; //By event number\n"
+      + spaces + "std::vector<Event> m_inputEvents; //What the scheduler is given for each input\n"
+      "#endif");
+  else
+    getCppTypeInfo()->hppStatements.push_back(
+    "#if defined(__linux__)\n"
+    + spaces + "void createEvents();\n"
+    + spaces + "void watchEvent(int fd, uint64_t event, int operation);\n"
+    + spaces + "static const uint64_t STOP_EVENT = 64;\n"
+    + spaces + "static const uint64_t TICK_EVENT = 65;\n"
+    + spaces + "int m_epollFd; //Waits on the inputs, stop() and the idle tick at once\n"
+    + spaces + "int m_stopFd; //eventfd written by stop()\n"
+    + spaces + "int m_tickFd; //timerfd that reruns an idle condition state\n"
+    + spaces + "bool m_isTickArmed;\n"
+    + spaces + "uint64_t m_readyInputs; //Inputs reported readable that their state has not read yet\n"
+    + spaces + "std::vector<int> m_inputFds; //By event number\n"
+    "#endif");
   //End struct/class in hpp.
   getCppTypeInfo()->hppStatements.push_back("}; //end class " + typeName);
 
   //Append includes in cpp for element classes accessed by this generated class.
   getCppTypeInfo()->appendAccessedElementIncludes();
+  //Include elements that are created here but not otherwise accessed.
+  for(const std::string& include : m_instanceIncludes)
+  {
+    auto& rIncludes = getCppTypeInfo()->cppIncludes;
+    if(rIncludes.end() == std::find(rIncludes.begin(), rIncludes.end(), include))
+      rIncludes.push_back(include);
+  }
+}
+
+void StateTableElement::generateInstanceCreation(ScopedBlock& rCtor)
+{
+  std::vector<std::string> instanceTypeNames;
+  bool requiresWsaSession = checkRequiresWsaSession();
+  for(std::shared_ptr<Element> pElement : Elements::elements())
+  {
+    if(!pElement->isUsedInStateTable() || !pElement->getCppTypeInfo() || pElement->isAsElement())
+      continue;
+    switch(pElement->getElementType())
+    {
+    case Types::ELEMENT_TYPE_IO_INPUT_UDP_IP:
+    case Types::ELEMENT_TYPE_IO_OUTPUT_UDP_IP:
+      requiresWsaSession = true;
+      //Fall-through since UDP elements also get an instance.
+    case Types::ELEMENT_TYPE_IO_INPUT_CONSOLE:
+    case Types::ELEMENT_TYPE_IO_OUTPUT_CONSOLE:
+    case Types::ELEMENT_TYPE_IO_INPUT_FILE:
+    case Types::ELEMENT_TYPE_IO_OUTPUT_FILE:
+    case Types::ELEMENT_TYPE_IO_OUTPUT_COLUMNS:
+      break;
+    default:
+      if(!pElement->getToken()->isElementGrammar())
+        continue;
+      break;
+    }
+    instanceTypeNames.push_back(pElement->getCppTypeInfo()->getTypeNameStr());
+  }
+  m_instanceTypeNames = instanceTypeNames;
+  if(instanceTypeNames.empty())
+    return;
+  if(requiresWsaSession)
+    rCtor << "static WSASession s_session; //Sockets need WSAStartup before they are created\n";
+  if(Generator::isSharded())
+    rCtor << "//Create this shard's element instances, which its worker thread then reads\n";
+  else
+    rCtor << "//Create each element instance once, before the worker thread reads them\n";
+  for(const std::string& instanceTypeName : instanceTypeNames)
+  {
+    if(Generator::isSharded())
+      rCtor << getShardInstanceMember(instanceTypeName) << " = " << instanceTypeName << "::create(shard);\n";
+    else
+      rCtor << instanceTypeName << "::create();\n";
+    std::string include("#include \"" + instanceTypeName + ".hpp\"\n");
+    auto& rIncludes = getCppTypeInfo()->cppIncludes;
+    if(rIncludes.end() == std::find(rIncludes.begin(), rIncludes.end(), include))
+      m_instanceIncludes.push_back(include);
+  }
+}
+
+void StateTableElement::generateInstanceSelection(ScopedBlock& rFunc)
+{
+  if(!Generator::isSharded() || m_instanceTypeNames.empty())
+    return;
+  rFunc << "//Element accessors called on this thread reach this shard's instances\n";
+  for(const std::string& instanceTypeName : m_instanceTypeNames)
+    rFunc << instanceTypeName << "::instance() = " << getShardInstanceMember(instanceTypeName) << ";\n";
+}
+
+void StateTableElement::generatePrefault(ScopedBlock& rFunc)
+{
+  if(m_eventInputs.empty())
+    return;
+  rFunc << "//Fault in the receive buffers now instead of on the first reads\n";
+  rFunc << "size_t prefaultBytes = RuntimeConfig::get().getPrefaultBytes();\n";
+  for(const std::string& eventInput : m_eventInputs)
+    rFunc << eventInput << "m_data.prefault(prefaultBytes);\n";
+}
+
+void StateTableElement::findEventInputs()
+{
+  //Events are bits of a 64 bit mask, so inputs past that are read without waiting.
+  m_eventInputs.clear();
+  for(std::shared_ptr<SubElement> pChild : getChildren()->children)
+  {
+    auto pInputElement = reinterpret_cast<SubElementState*>(pChild.get())->getInputElement();
+    if(pInputElement && Types::ELEMENT_TYPE_IO_INPUT_UDP_IP == pInputElement->getElementType() &&
+       m_eventInputs.size() < 64)
+    {
+      std::string accessor(pInputElement->getNodeAccessor());
+      if(m_eventInputs.end() == std::find(m_eventInputs.begin(), m_eventInputs.end(), accessor))
+        m_eventInputs.push_back(accessor);
+    }
+  }
+}
+
+std::string StateTableElement::getStateEvent(SubElementState* pStateSubElement)
+{
+  auto pInputElement = pStateSubElement->getInputElement();
+  if(!pInputElement)
+    return "TICK_WAIT";
+  auto findIt = std::find(m_eventInputs.begin(), m_eventInputs.end(), pInputElement->getNodeAccessor());
+  return m_eventInputs.end() != findIt ? std::to_string(findIt - m_eventInputs.begin()) : "NO_WAIT";
+}
+
+void StateTableElement::generateEventFunctions(
+  std::stringstream& line,
+  size_t& tabCount,
+  const std::vector<std::string>& stateEvents)
+{
+  std::string typeName(getCppTypeInfo()->typeNameStr);
+  std::string spaces(Utils::getTabSpace());
+  {
+    ScopedBlock stopFunc(line, tabCount, "void " + typeName + "::stop()", 2);
+    stopFunc << "m_isRunning = false;\n";
+    //The scheduler resumes a stopped session itself.
+    if(!Generator::isSessionScheduled())
+    {
+      line << "#if defined(__linux__)\n";
+      stopFunc << "uint64_t one = 1;\n";
+      stopFunc << "ssize_t written = ::write(m_stopFd, &one, sizeof(one));\n";
+      stopFunc << "(void)written;\n";
+      line << "#endif\n";
+    }
+  }
+  if(Generator::isSessionScheduled())
+    generateSessionFunctions(line, tabCount);
+  {
+    ScopedBlock waitFunc(line, tabCount, "bool " + typeName + "::waitForState(bool isIdle, int timeout)", 2);
+    if(Generator::isSessionScheduled())
+      waitFunc << "m_isTickWait = false;\n";
+    line << "#if defined(__linux__)\n";
+    waitFunc << "//What each state waits for: the event of its input, nothing for inputs that are\n";
+    waitFunc << "//always ready, or a tick for conditions that found nothing to do.\n";
+    waitFunc << "enum { NO_WAIT = -1, TICK_WAIT = -2 };\n";
+    std::string events("NO_WAIT");
+    for(const std::string& stateEvent : stateEvents)
+      events += ", " + stateEvent;
+    waitFunc << "static const int stateEvents[] = { " << events << " };\n";
+    waitFunc << "int stateEvent = stateEvents[m_state];\n";
+    waitFunc << "if(NO_WAIT == stateEvent && isIdle && timeout >= 0)\n";
+    waitFunc << spaces << "stateEvent = TICK_WAIT; //Waits for a tick rather than keep the caller busy\n";
+    {
+      ScopedBlock noWaitBlock(line, tabCount, "if(NO_WAIT == stateEvent || (TICK_WAIT == stateEvent && !isIdle))");
+      noWaitBlock << "if(isIdle)\n";
+      noWaitBlock << spaces << "std::this_thread::yield();\n";
+      noWaitBlock << "return m_isRunning;\n";
+    }
+    if(Generator::isSessionScheduled())
+    {
+      //The scheduler thread waits instead, and resumes the session once notify() was called.
+      {
+        ScopedBlock tickBlock(line, tabCount, "if(TICK_WAIT == stateEvent)");
+        tickBlock << "m_isTickWait = !m_isTick; //Resume after the next tick\n";
+        tickBlock << "m_isTick = false;\n";
+        tickBlock << "return !m_isTickWait && m_isRunning;\n";
+      }
+      waitFunc << "uint64_t inputBit = 1ull << stateEvent;\n";
+      waitFunc << "if(!(m_readyInputs & inputBit))\n";
+      waitFunc << spaces << "return false;\n";
+      waitFunc << "m_readyInputs &= ~inputBit;\n";
+      waitFunc << "watchEvent(m_inputFds[stateEvent], stateEvent, EPOLL_CTL_MOD);\n";
+    }
+    else
+    {
+      waitFunc << "uint64_t inputBit = stateEvent >= 0 ? 1ull << stateEvent : 0;\n";
+      {
+        ScopedBlock tickBlock(line, tabCount, "if(TICK_WAIT == stateEvent && !m_isTickArmed)");
+        tickBlock << "itimerspec tick = {};\n";
+        tickBlock << "tick.it_value.tv_nsec = 1000000; //1 ms\n";
+        tickBlock << "timerfd_settime(m_tickFd, 0, &tick, nullptr);\n";
+        tickBlock << "m_isTickArmed = true;\n";
+      }
+      waitFunc << "bool isTick = false;\n";
+      {
+        //A tick left from an earlier state does not end the wait for an input.
+        ScopedBlock waitBlock(line, tabCount, "while(m_isRunning && !(m_readyInputs & inputBit) && !(isTick && TICK_WAIT == stateEvent))");
+        waitBlock << "epoll_event events[8];\n";
+        waitBlock << "int count = epoll_wait(m_epollFd, events, 8, timeout);\n";
+        waitBlock << "if(count < 0 && EINTR != errno)\n";
+        waitBlock << spaces << "throw std::system_error(errno, std::system_category(), \"Error waiting for state table events\");\n";
+        waitBlock << "if(0 == count)\n";
+        waitBlock << spaces << "return false; //Nothing is ready yet\n";
+        ScopedBlock eventBlock(line, tabCount, "for(int i = 0; i < count; ++i)");
+        eventBlock << "uint64_t event = events[i].data.u64;\n";
+        {
+          ScopedBlock tickEventBlock(line, tabCount, "if(TICK_EVENT == event)");
+          tickEventBlock << "uint64_t expirations = 0;\n";
+          tickEventBlock << "isTick = sizeof(expirations) == ::read(m_tickFd, &expirations, sizeof(expirations));\n";
+          tickEventBlock << "if(isTick)\n";
+          tickEventBlock << spaces << "m_isTickArmed = false;\n";
+        }
+        eventBlock << "else if(STOP_EVENT != event)\n";
+        eventBlock << spaces << "m_readyInputs |= 1ull << event; //Reported once until its state reads it\n";
+      }
+      {
+        ScopedBlock readyBlock(line, tabCount, "if(m_readyInputs & inputBit)");
+        readyBlock << "m_readyInputs &= ~inputBit;\n";
+        readyBlock << "watchEvent(m_inputFds[stateEvent], stateEvent, EPOLL_CTL_MOD);\n";
+      }
+    }
+    line << "#else\n";
+    {
+      ScopedBlock idleBlock(line, tabCount, "if(isIdle)");
+      if(Generator::isSessionScheduled())
+      {
+        idleBlock << "m_isTickWait = true;\n";
+        idleBlock << "return false;\n";
+      }
+      else
+      {
+        idleBlock << "if(timeout >= 0)\n";
+        idleBlock << spaces << "return false;\n";
+        idleBlock << "//Yield CPU\n";
+        idleBlock << "std::chrono::milliseconds ms(0);\n";
+        idleBlock << "std::this_thread::sleep_for(ms);\n";
+      }
+    }
+    line << "#endif\n";
+    waitFunc << "return m_isRunning;\n";
+  }
+  if(Generator::isSessionScheduled())
+    return;
+  line << "#if defined(__linux__)\n";
+  {
+    ScopedBlock createFunc(line, tabCount, "void " + typeName + "::createEvents()", 2);
+    createFunc << "m_epollFd = epoll_create1(EPOLL_CLOEXEC);\n";
+    createFunc << "m_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);\n";
+    createFunc << "m_tickFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);\n";
+    createFunc << "m_isTickArmed = false;\n";
+    createFunc << "m_readyInputs = 0;\n";
+    createFunc << "if(m_epollFd < 0 || m_stopFd < 0 || m_tickFd < 0)\n";
+    createFunc << spaces << "throw std::system_error(errno, std::system_category(), \"Error creating state table events\");\n";
+    createFunc << "watchEvent(m_stopFd, STOP_EVENT, EPOLL_CTL_ADD);\n";
+    createFunc << "watchEvent(m_tickFd, TICK_EVENT, EPOLL_CTL_ADD);\n";
+    for(size_t i = 0; i < m_eventInputs.size(); ++i)
+    {
+      createFunc << "m_inputFds.push_back(static_cast<int>(" << m_eventInputs.at(i) << "getSocket()));\n";
+      createFunc << "watchEvent(m_inputFds.back(), " << std::to_string(i) << ", EPOLL_CTL_ADD);\n";
+    }
+  }
+  {
+    ScopedBlock watchFunc(line, tabCount, "void " + typeName + "::watchEvent(int fd, uint64_t event, int operation)", 2);
+    watchFunc << "//Inputs are reported once until their state reads them, so an input that is\n";
+    watchFunc << "//readable while another state runs does not keep waking the loop.\n";
+    watchFunc << "epoll_event ev = {};\n";
+    watchFunc << "ev.events = EPOLLIN;\n";
+    watchFunc << "if(event < STOP_EVENT)\n";
+    watchFunc << spaces << "ev.events |= EPOLLONESHOT;\n";
+    watchFunc << "ev.data.u64 = event;\n";
+    watchFunc << "if(epoll_ctl(m_epollFd, operation, fd, &ev) < 0)\n";
+    watchFunc << spaces << "throw std::system_error(errno, std::system_category(), \"Error waiting for state table events\");\n";
+  }
+  line << "#endif\n";
+}
+
+void StateTableElement::generateSessionFunctions(std::stringstream& line, size_t& tabCount)
+{
+  std::string typeName(getCppTypeInfo()->typeNameStr);
+  std::string spaces(Utils::getTabSpace());
+  {
+    ScopedBlock attachFunc(line, tabCount, "void " + typeName + "::attach(int epollFd)", 2);
+    line << "#if defined(__linux__)\n";
+    generateInstanceSelection(attachFunc);
+    attachFunc << "m_epollFd = epollFd;\n";
+    for(size_t i = 0; i < m_eventInputs.size(); ++i)
+    {
+      attachFunc << "m_inputFds.push_back(static_cast<int>(" << m_eventInputs.at(i) << "getSocket()));\n";
+      attachFunc << "m_inputEvents.push_back(Event());\n";
+    }
+    //The events are only handed out once the vector no longer grows.
+    {
+      ScopedBlock inputBlock(line, tabCount, "for(size_t i = 0; i < m_inputFds.size(); ++i)");
+      inputBlock << "m_inputEvents[i].pSession = this;\n";
+      inputBlock << "m_inputEvents[i].event = i;\n";
+      inputBlock << "watchEvent(m_inputFds[i], i, EPOLL_CTL_ADD);\n";
+    }
+    line << "#else\n";
+    attachFunc << "(void)epollFd;\n";
+    line << "#endif\n";
+  }
+  {
+    ScopedBlock detachFunc(line, tabCount, "void " + typeName + "::detach()", 2);
+    line << "#if defined(__linux__)\n";
+    detachFunc << "epoll_event ev = {};\n";
+    detachFunc << "for(int fd : m_inputFds)\n";
+    detachFunc << spaces << "epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, &ev);\n";
+    detachFunc << "m_inputFds.clear();\n";
+    line << "#endif\n";
+  }
+  {
+    ScopedBlock notifyFunc(line, tabCount, "void " + typeName + "::notify(uint64_t event)", 2);
+    notifyFunc << "if(TICK_EVENT == event)\n";
+    notifyFunc << spaces << "m_isTick = true;\n";
+    line << "#if defined(__linux__)\n";
+    notifyFunc << "else\n";
+    notifyFunc << spaces << "m_readyInputs |= 1ull << event; //Reported once until its state reads it\n";
+    line << "#endif\n";
+  }
+  line << "#if defined(__linux__)\n";
+  {
+    ScopedBlock watchFunc(line, tabCount, "void " + typeName + "::watchEvent(int fd, uint64_t event, int operation)", 2);
+    watchFunc << "//Inputs are reported once until their state reads them, so an input that is\n";
+    watchFunc << "//readable while another state runs does not keep resuming the session.\n";
+    watchFunc << "epoll_event ev = {};\n";
+    watchFunc << "ev.events = EPOLLIN | EPOLLONESHOT;\n";
+    watchFunc << "ev.data.ptr = &m_inputEvents[event];\n";
+    watchFunc << "if(epoll_ctl(m_epollFd, operation, fd, &ev) < 0)\n";
+    watchFunc << spaces << "throw std::system_error(errno, std::system_category(), \"Error waiting for state table events\");\n";
+  }
+  line << "#endif\n";
+}
+
+void StateTableElement::minimizeStates()
+{
+  auto& rRows = getChildren()->children;
+  if(rRows.empty())
+    return;
+  //Group the rows by state; else rows follow the row that names their state.
+  std::vector<std::string> states;
+  std::map<std::string, std::vector<SubElementState*> > stateRows;
+  for(std::shared_ptr<SubElement> pChild : rRows)
+  {
+    auto pRow = reinterpret_cast<SubElementState*>(pChild.get());
+    if(states.empty() || 0 != pRow->getState().find(states.back() + "_else"))
+      states.push_back(pRow->getState());
+    stateRows[states.back()].push_back(pRow);
+  }
+  size_t stateCount = states.size();
+  size_t rowCount = rRows.size();
+
+  //Drop the states the first state cannot reach.
+  std::set<std::string> reachable;
+  std::vector<std::string> pending(1, states.front());
+  while(!pending.empty())
+  {
+    std::string state(pending.back());
+    pending.pop_back();
+    if(!reachable.insert(state).second)
+      continue;
+    for(SubElementState* pRow : stateRows[state])
+    {
+      if(stateRows.count(pRow->getNextState()))
+        pending.push_back(pRow->getNextState());
+    }
+  }
+  std::map<std::string, std::string> replacements;
+  for(const std::string& state : states)
+  {
+    if(!reachable.count(state))
+    {
+      Utils::Logger::logWarn(stateRows[state].front()->getToken(), "State is unreachable and is not generated");
+      replacements[state].clear();
+    }
+  }
+  states.erase(std::remove_if(states.begin(), states.end(),
+    [&](const std::string& state)->bool { return !reachable.count(state); }), states.end());
+
+  //Merge equivalent states by partition refinement. States start out in the same block if
+  //their rows read, test and write the same things; a block is then split until each of
+  //its states moves to the same blocks on the same rows. The first state clears the IO
+  //buffers, so it is never merged.
+  std::map<std::string, size_t> blocks;
+  std::map<std::string, std::string> signatures;
+  for(const std::string& state : states)
+  {
+    std::string& rSignature = signatures[state];
+    rSignature = state == states.front() ? "first\n" : "";
+    for(SubElementState* pRow : stateRows[state])
+      rSignature += getRowSignature(state, pRow);
+  }
+  size_t blockCount = 0;
+  while(true)
+  {
+    std::map<std::string, size_t> keyBlocks;
+    std::map<std::string, size_t> refinedBlocks;
+    for(const std::string& state : states)
+    {
+      std::string key(signatures[state]);
+      if(!blocks.empty())
+      {
+        key = std::to_string(blocks[state]) + ":";
+        for(SubElementState* pRow : stateRows[state])
+        {
+          auto blockIt = blocks.find(pRow->getNextState());
+          key += blocks.end() != blockIt ? std::to_string(blockIt->second) + "," : "exit,";
+        }
+      }
+      auto inserted = keyBlocks.insert(std::make_pair(key, keyBlocks.size()));
+      refinedBlocks[state] = inserted.first->second;
+    }
+    blocks.swap(refinedBlocks);
+    if(keyBlocks.size() == blockCount)
+      break;
+    blockCount = keyBlocks.size();
+  }
+  std::map<size_t, std::string> blockStates;
+  for(const std::string& state : states)
+  {
+    auto inserted = blockStates.insert(std::make_pair(blocks[state], state));
+    if(!inserted.second)
+    {
+      Utils::Logger::logInfo(stateRows[state].front()->getToken(),
+        "State behaves the same as \"" + inserted.first->second + "\" and is merged into it");
+      replacements[state] = inserted.first->second;
+    }
+  }
+  if(replacements.empty())
+    return;
+
+  //Remove the rows of dropped states and send their transitions to the state they merged into.
+  rRows.erase(std::remove_if(rRows.begin(), rRows.end(),
+    [&](std::shared_ptr<SubElement> pChild)->bool
+    {
+      auto pRow = reinterpret_cast<SubElementState*>(pChild.get());
+      auto replacementIt = std::find_if(replacements.begin(), replacements.end(),
+        [&](const std::pair<const std::string, std::string>& replacement)->bool
+        { return pRow->getState() == replacement.first || 0 == pRow->getState().find(replacement.first + "_else"); });
+      if(replacements.end() == replacementIt)
+        return false;
+      getChildren()->childTable.erase(pChild->getToken()->text);
+      return true;
+    }), rRows.end());
+  for(std::shared_ptr<SubElement> pChild : rRows)
+  {
+    auto pRow = reinterpret_cast<SubElementState*>(pChild.get());
+    auto replacementIt = replacements.find(pRow->getNextState());
+    if(replacements.end() != replacementIt)
+      pRow->setNextState(replacementIt->second);
+  }
+  Utils::Logger::logInfo(getToken()->lineNumber, "\"" + getName() + "\": State table reduced from " +
+    std::to_string(stateCount) + " states and " + std::to_string(rowCount) + " rows to " +
+    std::to_string(stateCount - replacements.size()) + " states and " + std::to_string(rRows.size()) + " rows");
 }
 
 bool StateTableElement::checkRequiresWsaSession()
@@ -14,6 +14,9 @@
 #include <set>
 #include <sstream>
 
+class ScopedBlock;
+class SubElementState;
+
 class StateTableElement : public Element
 {
 public:
@@ -21,7 +24,25 @@ public:
   virtual std::string getTypeName() const { return "StateTableElement"; }
   void generateCode();
 private:
+  /** Drops states the first state cannot reach and merges states that behave the same. */
+  void minimizeStates();
+  void generateInstanceCreation(ScopedBlock& rCtor);
+  /** Points the element accessors of the calling thread at the shard's instances. */
+  void generateInstanceSelection(ScopedBlock& rFunc);
+  void generatePrefault(ScopedBlock& rFunc);
   bool checkRequiresWsaSession();
+  /** Finds the inputs that the event loop can wait on, i.e. sockets. */
+  void findEventInputs();
+  /** @return the event a state waits for before it runs, as an entry of the generated stateEvents table. */
+  std::string getStateEvent(SubElementState* pStateSubElement);
+  void generateEventFunctions(std::stringstream& line, size_t& tabCount, const std::vector<std::string>& stateEvents);
+  /** Generates the Session functions that register the inputs in the epoll of the scheduler thread. */
+  void generateSessionFunctions(std::stringstream& line, size_t& tabCount);
+  std::vector<std::string> m_instanceIncludes;
+  /** Elements the state table creates an instance of, by type name. */
+  std::vector<std::string> m_instanceTypeNames;
+  /** Accessors of the inputs the event loop waits on, e.g. In::get()->, by event number. */
+  std::vector<std::string> m_eventInputs;
 };
 
 #endif //STATETABLEELEMENT_HPP
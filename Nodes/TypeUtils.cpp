@@ -119,6 +119,18 @@ bool TypeUtils::getCppTypeInfo(std::shared_ptr<Token> pTypeToken, std::shared_pt
     pCppInfo = std::make_shared<CppTypeInfo>();
   bool isUnsigned = pTypeToken->isSymbolTypedUnsigned();
   std::string typeStr(pTypeToken->text);
+  //Checksums are unsigned numbers computed over the fields they cover.
+  static const std::map<std::string, std::string> checksumFuncs = {
+    {"CRC_32C", "crc32c"}, {"CRC_32", "crc32"}, {"ADLER_32", "adler32"}, {"FLETCHER_16", "fletcher16"}};
+  auto checksumIt = checksumFuncs.find(typeStr);
+  if(checksumIt != checksumFuncs.end())
+  {
+    pCppInfo->checksumStr = checksumIt->second;
+    pCppInfo->typeSizeBits = static_cast<size_t>(Utils::stoll(typeStr.substr(typeStr.find_last_of("_") + 1)));
+    pCppInfo->resolvedSizeBytes = pCppInfo->typeSizeBits / CHAR_BIT;
+    pCppInfo->typeStr = 16 == pCppInfo->typeSizeBits ? "uint16_t" : "uint32_t";
+    return true;
+  }
   auto pos = typeStr.find_last_of("_");
   if(pos != std::string::npos)
   {
@@ -45,7 +45,7 @@ namespace
     if(!pSubElement->getToken()->isSymbolTyped())
       return false;
     std::smatch res;
-    std::regex reg("(INT_STR|FLOAT_STR|BIT|BYTE|FLOAT|INT).*");
+    std::regex reg("(INT_STR|FLOAT_STR|BIT|BYTE|FLOAT|INT|CRC|ADLER|FLETCHER).*");
     if(!std::regex_match(pSubElement->getToken()->text.cbegin(),
        pSubElement->getToken()->text.cend(), res, reg))
       return false;
@@ -334,6 +334,16 @@ void GrammarElementParser::parseRange(std::shared_ptr<Tokens> pTokens)
         pTypeSubElement->setCppTypeInfo(
           TypeUtils::getCppTypeInfo(pTypeSubElement.get(), pTypeSubElement.get()));
       }
+      if(pTypeSubElement->getCppTypeInfo()->isChecksum())
+      {
+        //A checksum's range names the first and last fields it covers, not a count.
+        pTypeSubElement->getCppTypeInfo()->pChecksumRange =
+          std::make_shared<TypeRange>(m_pAssignedSubElement, rangeTokens);
+        if(!pTypeSizeCastSubElement)
+          m_pAssignedSubElement->setCppTypeInfo(pTypeSubElement->getCppTypeInfo());
+        pTokens->nextToken();
+        return;
+      }
       pTypeSubElement->getCppTypeInfo()->pTypeRange =
         std::make_shared<TypeRange>(m_pAssignedSubElement, rangeTokens);
       size_t sz = pTypeSubElement->getCppTypeInfo()->pTypeRange->getSize();
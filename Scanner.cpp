@@ -401,7 +401,7 @@ namespace
               std::shared_ptr<Token>& pToken,
               size_t& rPos)
   {
-    static std::string types[] = {"BIT", "BYTE", "CHAR", ""};
+    static std::string types[] = {"BIT", "BYTE", "CHAR", "CRC_32C", "CRC_32", "ADLER_32", "FLETCHER_16", ""};
     if(isMatch(types, inStr, pToken, rPos))
     {
       auto pLastToken = Utils::getItemAt(m_tokenList, m_tokenList.size() - 1);
@@ -701,7 +701,7 @@ namespace
                 std::shared_ptr<Token>& pToken,
                 size_t& rPos)
   {
-    static std::string types[] = {"TCP_IP", "UDP_IP", "FILE", "MYSQL", "GUI", "CONSOLE" ,""};
+    static std::string types[] = {"TCP_IP", "UDP_IP", "FILE", "MYSQL", "GUI", "CONSOLE", "COLUMNS", ""};
     if(isMatch(types, inStr, pToken, rPos) &&
        (Token::ELEMENT_INPUT == currentElementType ||
         Token::ELEMENT_OUTPUT == currentElementType))
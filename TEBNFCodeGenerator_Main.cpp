@@ -30,11 +30,22 @@ int main(int argc, const char* argv[])
       auto pos = strPath.find_last_of("/\\");
       exeName = std::string::npos != pos ? strPath.substr(pos + 1) : strPath;
     }
-    std::cout << "Usage: " << exeName << " <source> <destination> <name>\n"
+    std::cout << "Usage: " << exeName << " <source> <destination> <name> [shards] [sessions] [inline_actions] [setting=value...]\n"
       << "Arguments:\n"
       << "  source - Path of file containing TEBNF grammar, including file name.\n"
       << "  destination - Path of the location on disk to write generated files.\n"
-      << "  name - Name to give to the generated application.\n";
+      << "  name - Name to give to the generated application.\n"
+      << "  shards - Optional number of copies of each state table to run, each with its own\n"
+      << "           element instances. UDP inputs share their port. Defaults to 1. On Linux,\n"
+      << "           SIGINT or SIGTERM stops the shards and prints the sums of their $ counters,\n"
+      << "           the numeric $ variables that are only ever added to, e.g. with ++ or +=.\n"
+      << "  sessions - Optionally runs the shards as sessions that a few threads resume when their\n"
+      << "             inputs are ready, instead of a thread each, for many shards per core.\n"
+      << "  inline_actions - Optionally defines ACTIONS in their headers as noexcept templates that\n"
+      << "                   the state tables can inline. An action that throws then terminates.\n"
+      << "  setting=value - Optional runtime settings built in as defaults, which the generated\n"
+      << "                  <name>.conf file overrides: cpus=2,3 priority=80 mlockall=1\n"
+      << "                  prefault_bytes=1048576 workers=4, or <state table>.cpus and <state table>.priority.\n";
   }
   else
   {
@@ -43,6 +54,30 @@ int main(int argc, const char* argv[])
       std::string srcFilePath(argv[1]);
       std::string destDirPath(argv[2]);
       std::string appName(argv[3]);
+      for(int argIdx = 4; argIdx < argc; argIdx++)
+      {
+        std::string arg(argv[argIdx]);
+        auto equals = arg.find('=');
+        if("sessions" == arg)
+        {
+          Generator::setSessionScheduled(true);
+          continue;
+        }
+        if("inline_actions" == arg)
+        {
+          Generator::setInlineActions(true);
+          continue;
+        }
+        if(std::string::npos != equals)
+        {
+          Generator::setRuntimeOption(arg.substr(0, equals), arg.substr(equals + 1));
+          continue;
+        }
+        unsigned long shardCount = std::stoul(arg);
+        if(0 == shardCount)
+          throw std::invalid_argument("Shard count must be at least 1");
+        Generator::setShardCount(shardCount);
+      }
       Utils::Logger::setup(srcFilePath); //Setup static logger.
       Utils::Logger::log("\n--------- TEBNF Code Generator v" + Utils::getTEBNFVersion() + " ---------\n");
       Reader::read(srcFilePath);